@@ -1,3 +1,4 @@
+#ifdef __PCM__
 #include <16F887.h>
 // Configuration bits: Internal oscillator, No Watchdog (managed manually), No protection
 #fuses INTRC_IO, NOWDT, NOPROTECT, NOLVP, NOBROWNOUT, PUT, NOMCLR
@@ -6,6 +7,9 @@
 // Bluetooth UART configuration
 // Changed stream name from BT_MODUL to BT_MODULE
 #use rs232(baud = 9600, parity = N, xmit = PIN_C6, rcv = PIN_C7, bits = 8, stream = BT_MODULE)
+#else
+#include "sim/hal.h" // Host build against the simulator's mock hardware (src/sim)
+#endif
 
 #include <string.h>
 #include <stdlib.h>
@@ -18,7 +22,9 @@
 #define LCD_DATA5 PIN_D5
 #define LCD_DATA6 PIN_D6
 #define LCD_DATA7 PIN_D7
+#ifdef __PCM__
 #include <LCD.C>
+#endif
 
 // --- Output Pins ---
 #define LED_PIN PIN_A0      // Status LED
@@ -35,14 +41,88 @@
 char morse_buffer[10];      // Buffer to store current dots/dashes
 char text_buffer[21];       // Buffer to store decoded text message
 int8 morse_index = 0;
+int8 morse_node = 1;        // Table index of the dots/dashes typed so far
 int8 text_index = 0;
 
-char rx_temp_buffer[40];    // Temporary buffer for incoming Bluetooth data
 char rx_display_buffer[25]; // Buffer for text to be displayed on LCD line 4
+
+// Incoming frames, queued by serial_isr for the main loop (single producer,
+// single consumer). The ISR fills slot rx_head and only advances rx_head
+// once the frame is complete; the main loop only advances rx_tail. One slot
+// is always being filled, so up to RX_SLOTS - 1 frames can wait.
+// LINK_PAYLOAD_MAX covers the longest payload the desktop sends, a 24
+// character message behind the reliable delivery header "NN,M,"; a slot
+// holds it as "$D,<payload>*CS" plus the '\0', or as a COBS frame.
+#define LINK_PAYLOAD_MAX 29
+#define RX_SLOTS 3
+#define RX_SLOT_SIZE 36
+#define RX_BINARY_FLAG 0x80         // Set in rx_lengths for COBS frames
+char rx_frames[RX_SLOTS][RX_SLOT_SIZE];
+int8 rx_lengths[RX_SLOTS];
+volatile int8 rx_head = 0;          // Slot being filled, written by serial_isr only
+volatile int8 rx_tail = 0;          // Oldest complete frame, written by the main loop only
 int8 rx_temp_index = 0;
-int1 rx_data_ready = 0;     // Flag indicating new data arrived
+int1 rx_in_binary = 0;              // Collecting a COBS frame (after a 0x00 delimiter)
+
+// Receive counters, reported to the desktop with "$K,stat"
+int16 rx_overflow_count = 0;        // Complete frames dropped because the queue was full
+int16 rx_oversize_count = 0;        // Frames that did not fit a slot
+int16 rx_error_count = 0;           // Frames that failed the format, checksum or CRC check
+
+// Binary framing, negotiated by the desktop with "$K,bin_set,1".
+// Frame: 0x00, COBS(type, len, payload, crc_hi, crc_lo), 0x00 with a
+// CRC-16/CCITT-FALSE over type, len and payload. Incoming frames of both
+// kinds are always accepted; this flag only selects what we send.
+int1 link_binary = 0;
+
+// Reliable delivery, negotiated by the desktop with "$K,arq_set,1". Packets
+// then arrive as "$D,seq,T,payload" (seq 0..63); every copy is answered with
+// "$A,seq" and handled once, in whatever order they arrive. A damaged frame
+// is answered with "$N,seq" of the oldest missing packet, which the desktop
+// resends at once. The desktop keeps at most 3 packets unacked (the receive
+// queue), so 8 tracked numbers cover its window; a packet further ahead means
+// the desktop gave up on the ones before it, and the window slides past them.
+#define ARQ_SEQ_LIMIT 64           // Power of two
+#define ARQ_TRACKED 8              // Numbers tracked from arq_next on (bits of arq_seen)
+int1 link_arq = 0;
+int8 arq_next = 0;                 // Oldest sequence number not received yet
+int8 arq_seen = 0;                 // Received numbers after it, bit n = arq_next + n
+
+// Outgoing UART bytes, drained by the INT_TBE interrupt so sending a packet
+// only costs the enqueue. 32 bytes hold one full frame; a second frame sent
+// right after it waits only for the bytes that do not fit.
+#define TX_BUFFER_SIZE 32 // Must be a power of two
+char tx_buffer[TX_BUFFER_SIZE];
+volatile int8 tx_head = 0; // Next free slot, written by the main loop only
+volatile int8 tx_tail = 0; // Next byte to send, written by the ISR only
 
 volatile int16 press_counter = 0; // Timer to measure how long a button is pressed
+
+// Adaptive keying speed. Presses are sorted into two clusters, dots and
+// dashes, whose running averages (Timer1 ticks x 16) follow the operator;
+// a press is a dash when it is closer to the dash average. The speed is
+// shown as WPM (PARIS: one dot = 1200 / WPM ms) and saved in the journal.
+#define KEYING_DEFAULT_WPM 8       // Dot 150 ms: the old fixed 300 ms split
+#define KEYING_MIN_DOT 24          // 1.5 ticks, the Timer1 resolution limit
+#define KEYING_MAX_PRESS 2000      // Longer presses are clipped (20 s)
+int16 dot_estimate;                // Written by timer1_isr once running
+int16 dash_estimate;
+int8 keying_debounce = 2;          // Presses up to this many ticks are bounce
+int8 keying_wpm = KEYING_DEFAULT_WPM; // Saved speed (journal cell JOURNAL_WPM)
+
+// Gap commit mode: timer1_isr times the silence after each element and asks
+// the main loop to commit the character after about 3 dots (at 2.5) and to
+// add a space after about 7 (at 5). BTN_UPLOAD still commits at any time.
+#define GAP_ELEMENT 0              // Within a character
+#define GAP_CHARACTER 1            // Character committed, a space may follow
+#define GAP_WORD 2                 // Nothing left to do until the next press
+int1 commit_auto = 0;              // 0 = BTN_UPLOAD commits, 1 = gaps commit (JOURNAL_COMMIT)
+int16 gap_counter = 0;             // Ticks since the last element ended
+int16 gap_char_ticks;              // Thresholds, follow dot_estimate
+int16 gap_word_ticks;
+int8 gap_stage = GAP_WORD;
+volatile int1 commit_pending = 0;  // Set by timer1_isr, handled by the main loop
+volatile int1 space_pending = 0;
 volatile int16 idle_counter = 0;  // Timer to measure inactivity
 #define SLEEP_TIMEOUT 3000        // Inactivity limit before sleep
 
@@ -55,38 +135,142 @@ int8 scroll_pos = 0;           // Current scroll position
 
 int1 app_mode = 0; // 0 = Message Mode, 1 = Command Mode
 
-// Morse Code Lookup Tree (Binary Heap Structure)
-// Left child = Dot, Right child = Dash
-const char morse_tree[64] = {
+// Cooperative scheduler. timer1_isr counts 10 ms ticks; the main loop never
+// waits and runs its timed work (buttons, splash screens, sleep) once per
+// tick. Buttons B1..B4 are debounced into events by button_poll.
+#define BUTTONS 4
+#define BUTTON_UPLOAD 0
+#define BUTTON_DELETE 1
+#define BUTTON_RESET 2
+#define BUTTON_MODE 3
+#define BUTTON_DEBOUNCE 2          // Ticks a pin change must last (20 ms)
+#define BTN_EV_NONE 0
+#define BTN_EV_PRESS 1             // Debounced press
+#define BTN_EV_SHORT 2             // Released before the long-press time
+#define BTN_EV_LONG 3              // Held for the long-press time (still held)
+#define BTN_EV_RELEASE 4           // Released after a long press or a shortcut
+#define BUTTON_SLEEP_COMBO ((1 << BUTTON_RESET) | (1 << BUTTON_MODE))
+volatile int8 tick_count = 0;      // Timer1 ticks, wraps
+int8 tick_seen = 0;                // Last tick handled by the main loop
+int8 button_held[BUTTONS];         // Ticks the debounced press has lasted
+int8 button_bounce[BUTTONS];       // Ticks the pin has disagreed with the debounced state
+int8 button_down = 0;              // Debounced state, one bit per button
+int8 button_done = 0;              // Long press reported or consumed: no SHORT on release
+int8 splash_ticks = 0;             // Splash screen time left; the normal screen waits
+int1 sleep_pending = 0;            // Sleep once the "SLEEP MODE..." splash is over
+volatile int8 beep_ticks = 0;      // Buzzer time left, switched off by timer1_isr
+
+// LCD shadow framebuffer: what the 20x4 panel currently shows, row by row.
+// Screens are drawn through lcd_shadow_putc, which only sends characters
+// that differ from the shadow and only moves the cursor when the next
+// changed cell is not where the panel cursor already is.
+#define LCD_COLS 20
+#define LCD_ROWS 4
+#define LCD_CURSOR_UNKNOWN 0xFF
+char lcd_shadow[LCD_COLS * LCD_ROWS];
+int8 lcd_draw_pos = 0;     // Shadow index the next drawn character goes to
+int8 lcd_draw_end = 0;     // End of the row being drawn, later characters are dropped
+int8 lcd_cursor = 0;       // Shadow index of the panel cursor
+
+// EEPROM journal. The saved text and the last received message are kept as
+// "cells" (one per character, terminator included) and every change is
+// appended as a two-byte record: tag (cell number, bit 7 = parity) and value.
+// Records go into one of two 96-byte halves; when it is full the live cells
+// are copied into the other half, which then takes over via its header record
+// (generation counter). Writes run in the background, one byte per EEPROM
+// interrupt; the main loop only marks cells dirty. 0xC0..0xFF: outbox.
+#define JOURNAL_HALF_A 0x00
+#define JOURNAL_HALF_B 0x60
+#define JOURNAL_SLOTS 48           // Records per half, slot 0 is the header
+#define JOURNAL_TEXT 0             // Cells 0..20: text_buffer
+#define JOURNAL_RX 21              // Cells 21..41: rx_display_buffer
+#define JOURNAL_SETTINGS 42        // Cells 42..: settings, always live
+#define JOURNAL_WPM 42             // keying_wpm
+#define JOURNAL_COMMIT 43          // commit_auto
+#define JOURNAL_CELLS 44
+#define JOURNAL_HEADER 0x7E        // Cell number of the header record
+#define JOURNAL_END 0xFF           // Tag of an unused slot
+#define JOURNAL_NONE 0xFF
+
+// Writer phases, advanced by journal_step
+#define JOURNAL_IDLE 0
+#define JOURNAL_APPEND_TAG 1
+#define JOURNAL_COPY 2
+#define JOURNAL_COPY_TAG 3
+#define JOURNAL_ERASE 4
+#define JOURNAL_HEADER_VALUE 5
+#define JOURNAL_HEADER_TAG 6
+
+int8 journal_dirty[(JOURNAL_CELLS + 7) / 8]; // Cells changed since they were last written
+int1 journal_half = 0;             // Half holding the current journal (0 = A, 1 = B)
+int8 journal_gen = 0;              // Generation of the current half
+int8 journal_slot = 0;             // Next free slot in the current half
+int8 journal_phase = JOURNAL_IDLE;
+int8 journal_tag = 0;              // Tag to write once its value is written
+int8 journal_copy_cell = 0;        // Next cell to copy into the other half
+int8 journal_copy_slot = 0;        // Next slot to fill in the other half
+volatile int1 journal_busy = 0;    // An EEPROM write is in progress
+
+// Outbox: sent messages wait in EEPROM (0xC0..0xFE) until the desktop acks
+// them, so nothing keyed during a link dropout is lost. Slot = header
+// (sequence number, type bit, delivered bit) + 20 text bytes; the header is
+// written last, so a slot interrupted by a reset never shows up. Slots are
+// filled in ring order by the journal writer when it has nothing else to do.
+// On the wire: "$Q,seq,T,text" (T = M or K), answered with "$K,ack,seq".
+// The desktop sends "$K,hb" every few seconds; without it nothing is sent.
+#define OUTBOX_BASE 0xC0
+#define OUTBOX_SLOTS 3
+#define OUTBOX_SLOT_SIZE 21
+#define OUTBOX_TEXT 20
+#define OUTBOX_SEQ_LIMIT 63        // Sequence numbers 0..62: a header is never 0xFF
+#define OUTBOX_DELIVERED 0x80      // Header bit: acked, the slot may be reused
+#define OUTBOX_COMMAND 0x40        // Header bit: command mode ($K) message
+#define OUTBOX_UNUSED 0xFF         // Header of a slot never written
+#define OUTBOX_FILL_RETIRE 1       // Fill steps: mark the old header delivered,
+#define OUTBOX_FILL_TEXT 2         // then text bytes 2..21,
+#define OUTBOX_FILL_HEADER 22      // then the new header
+#define OUTBOX_LINK_TICKS 600      // Link counts as up for 6 s after "$K,hb"
+#define OUTBOX_RETRY_TICKS 200     // Resend what is not acked after 2 s
+int8 outbox_head = 0;              // Slot the next message goes into (the oldest)
+int8 outbox_seq = 0;               // Its sequence number
+int8 outbox_seqs[OUTBOX_SLOTS];    // Sequence number of each pending slot
+int8 outbox_pending = 0;           // Slots not yet acked, bit per slot
+int8 outbox_sent = 0;              // Pending slots sent on this link and not yet timed out
+int8 outbox_release = 0;           // Acked slots whose header still says pending
+int8 outbox_header = 0;            // Header of the slot being filled
+volatile int8 outbox_fill = 0;     // Fill step of slot outbox_head, 0 = idle
+int1 outbox_storing = 0;           // text_buffer is being copied, leave it alone
+int16 link_ticks = 0;              // Time left before the link counts as down
+int8 outbox_retry = 0;             // Ticks until unacked messages are resent
+
+// Data EEPROM registers, for writes that do not wait for completion
+#ifdef __PCM__
+#byte EEDAT = 0x10C
+#byte EEADR = 0x10D
+#byte EECON1 = 0x18C
+#byte EECON2 = 0x18D
+#bit EEPGD = EECON1.7
+#bit WREN = EECON1.2
+#bit WR = EECON1.1
+#endif
+
+// Morse Code Lookup Table (Binary Heap Structure)
+// Start at 1, a dot goes to 2n and a dash to 2n+1. Covers codes of up to
+// six elements: letters, digits, punctuation and the prosigns AR ('+'),
+// BT ('=') and SK ('#'). Generated by src/sim/morse_table.c, do not edit.
+#define MORSE_MAX_ELEMENTS 6
+#define MORSE_UNKNOWN_GLYPH 0xFF // Full block on the HD44780, previews an unknown code
+const char morse_table[128] = {
     0, 0, 'E', 'T', 'I', 'A', 'N', 'M', 'S', 'U', 'R', 'W', 'D', 'K', 'G', 'O',
     'H', 'V', 'F', 0, 'L', 0, 'P', 'J', 'B', 'X', 'C', 'Y', 'Z', 'Q', 0, 0,
-    '5', '4', 0, '3', 0, 0, 0, '2', 0, 0, 0, 0, 0, 0, 0, '1',
-    '6', 0, 0, 0, 0, 0, 0, 0, '7', 0, 0, 0, '8', 0, '9', '0'};
-
-// Delay function that keeps resetting the Watchdog Timer
-void wdt_delay_ms(int16 time)
-{
-    int16 i;
-    for (i = 0; i < time; i++)
-    {
-        delay_ms(1);
-        restart_wdt();
-    }
-}
-
-// Save the current text message to EEPROM (Permanent memory)
-void save_text_to_eeprom()
-{
-    int8 i;
-    write_eeprom(0, text_index);
-    for (i = 0; i < text_index; i++)
-    {
-        write_eeprom(i + 1, text_buffer[i]);
-        restart_wdt();
-    }
-}
-
-// Load the saved text message from EEPROM
+    '5', '4', 0, '3', 0, 0, 0, '2', '&', 0, '+', 0, 0, 0, 0, '1',
+    '6', '=', '/', 0, 0, 0, '(', 0, '7', 0, 0, 0, '8', 0, '9', '0',
+    0, 0, 0, 0, 0, '#', 0, 0, 0, 0, 0, 0, '?', '_', 0, 0,
+    0, 0, '"', 0, 0, '.', 0, 0, 0, 0, '@', 0, 0, 0, '\'', 0,
+    0, '-', 0, 0, 0, 0, 0, 0, 0, 0, ';', '!', 0, ')', 0, 0,
+    0, 0, 0, ',', 0, 0, 0, 0, ':', 0, 0, 0, 0, 0, 0, 0};
+
+// Load a message saved in the old fixed layout (before the journal)
 void load_text_from_eeprom()
 {
     int8 i;
@@ -101,55 +285,529 @@ void load_text_from_eeprom()
     text_buffer[text_index] = '\0';
 }
 
-// Save the received Bluetooth message to EEPROM
-void save_bt_to_eeprom()
+// Load a received message saved in the old fixed layout
+void load_bt_from_eeprom()
 {
     int8 i, len;
-    len = strlen(rx_display_buffer);
-    write_eeprom(50, len);
+    len = read_eeprom(50);
+    if (len > 20)
+        len = 0;
+
     for (i = 0; i < len; i++)
     {
-        write_eeprom(51 + i, rx_display_buffer[i]);
+        rx_display_buffer[i] = read_eeprom(51 + i);
         restart_wdt();
     }
+    rx_display_buffer[len] = '\0';
 }
 
-// Load the last Bluetooth message from EEPROM
-void load_bt_from_eeprom()
+// Even parity of a byte
+int1 journal_parity(int8 x)
+{
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+// Tag for a record; the parity bit makes the record's bit count odd, so
+// erased (0xFF, 0xFF) and cleared (0x00, 0x00) slots never look valid
+int8 journal_make_tag(int8 cell, int8 value)
+{
+    if (journal_parity(cell ^ value))
+        return cell;
+    return cell | 0x80;
+}
+
+int1 journal_record_valid(int8 tag, int8 value)
+{
+    return tag != JOURNAL_END && journal_parity(tag ^ value);
+}
+
+// EEPROM address of a slot
+int8 journal_address(int1 half, int8 slot)
+{
+    if (half)
+        return JOURNAL_HALF_B + slot * 2;
+    return JOURNAL_HALF_A + slot * 2;
+}
+
+// RAM byte a cell mirrors
+int8 journal_get(int8 cell)
+{
+    if (cell < JOURNAL_RX)
+        return text_buffer[cell - JOURNAL_TEXT];
+    if (cell < JOURNAL_SETTINGS)
+        return rx_display_buffer[cell - JOURNAL_RX];
+    if (cell == JOURNAL_WPM)
+        return keying_wpm;
+    return commit_auto;
+}
+
+void journal_put(int8 cell, int8 value)
+{
+    if (cell < JOURNAL_RX)
+        text_buffer[cell - JOURNAL_TEXT] = value;
+    else if (cell < JOURNAL_SETTINGS)
+        rx_display_buffer[cell - JOURNAL_RX] = value;
+    else if (cell == JOURNAL_WPM)
+        keying_wpm = value;
+    else if (cell == JOURNAL_COMMIT)
+        commit_auto = value & 1;
+}
+
+// Cells past a string's terminator are never read back, so they are not saved
+int1 journal_cell_live(int8 cell)
+{
+    int8 len;
+    if (cell < JOURNAL_RX)
+    {
+        len = strlen(text_buffer);
+        return cell - JOURNAL_TEXT <= len;
+    }
+    if (cell < JOURNAL_SETTINGS)
+    {
+        len = strlen(rx_display_buffer);
+        return cell - JOURNAL_RX <= len;
+    }
+    return 1;
+}
+
+// Take the highest dirty cell, or JOURNAL_NONE. Going downwards saves a
+// string's new terminator before the characters in front of it, so a reset
+// in between never exposes stale characters past the old end.
+int8 journal_take_dirty()
+{
+    int8 cell = JOURNAL_CELLS;
+    while (cell-- > 0)
+    {
+        if (bit_test(journal_dirty[cell >> 3], cell & 7))
+        {
+            bit_clear(journal_dirty[cell >> 3], cell & 7);
+            return cell;
+        }
+    }
+    return JOURNAL_NONE;
+}
+
+// Start writing one EEPROM byte; completion raises INT_EEPROM. Returns 0
+// without writing if the byte already holds the value.
+int1 journal_write(int8 address, int8 value)
+{
+    if (read_eeprom(address) == value)
+        return 0;
+    EEADR = address;
+    EEDAT = value;
+    EEPGD = 0;
+    WREN = 1;
+    EECON2 = 0x55; // Unlock sequence, interrupts are off here
+    EECON2 = 0xAA;
+    WR = 1;
+    WREN = 0;
+    journal_busy = 1;
+    return 1;
+}
+
+// Slot address in EEPROM
+int8 outbox_address(int8 slot)
+{
+    return OUTBOX_BASE + slot * OUTBOX_SLOT_SIZE;
+}
+
+// Next outbox EEPROM write, once the journal has nothing to save. Returns 1
+// if a write was started. Called from journal_step only.
+int1 outbox_step()
+{
+    int8 slot, address, value;
+
+    while (outbox_fill != 0)
+    {
+        address = outbox_address(outbox_head);
+        if (outbox_fill == OUTBOX_FILL_RETIRE)
+        {
+            // The slot's last message was acked; say so before its text goes
+            outbox_fill = OUTBOX_FILL_TEXT;
+            if (journal_write(address, read_eeprom(address) | OUTBOX_DELIVERED))
+                return 1;
+        }
+        else if (outbox_fill == OUTBOX_FILL_HEADER)
+        {
+            outbox_fill = 0;
+            if (journal_write(address, outbox_header))
+                return 1;
+        }
+        else
+        {
+            value = text_buffer[outbox_fill - OUTBOX_FILL_TEXT];
+            // Commands go out with commas between the words
+            if (value == ' ' && (outbox_header & OUTBOX_COMMAND))
+                value = ',';
+            address += outbox_fill - 1;
+            if (value == '\0')
+                outbox_fill = OUTBOX_FILL_HEADER;
+            else
+                outbox_fill++;
+            if (journal_write(address, value))
+                return 1;
+        }
+    }
+
+    for (slot = 0; slot < OUTBOX_SLOTS; slot++)
+    {
+        if (outbox_release & (1 << slot))
+        {
+            outbox_release &= ~(1 << slot);
+            address = outbox_address(slot);
+            if (journal_write(address, read_eeprom(address) | OUTBOX_DELIVERED))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Advance the journal until one EEPROM write is running or nothing is left.
+// Runs from the EEPROM interrupt, or from journal_mark with interrupts off.
+void journal_step()
+{
+    int8 cell, value;
+
+    while (TRUE)
+    {
+        switch (journal_phase)
+        {
+        case JOURNAL_IDLE:
+            cell = journal_take_dirty();
+            if (cell == JOURNAL_NONE)
+            {
+                outbox_step();
+                return;
+            }
+            if (!journal_cell_live(cell))
+                break;
+            if (journal_slot >= JOURNAL_SLOTS)
+            {
+                // Half full: copy the live cells (current values) to the other half
+                memset(journal_dirty, 0, sizeof(journal_dirty));
+                journal_copy_cell = 0;
+                journal_copy_slot = 1;
+                journal_phase = JOURNAL_COPY;
+                break;
+            }
+            value = journal_get(cell);
+            journal_tag = journal_make_tag(cell, value);
+            journal_phase = JOURNAL_APPEND_TAG;
+            if (journal_write(journal_address(journal_half, journal_slot) + 1, value))
+                return;
+            break;
+
+        case JOURNAL_APPEND_TAG:
+            // The tag goes last: a record interrupted by a reset stays invalid
+            journal_phase = JOURNAL_IDLE;
+            if (journal_write(journal_address(journal_half, journal_slot++), journal_tag))
+                return;
+            break;
+
+        case JOURNAL_COPY:
+            cell = journal_copy_cell;
+            while (cell < JOURNAL_CELLS && !journal_cell_live(cell))
+                cell++;
+            if (cell >= JOURNAL_CELLS)
+            {
+                journal_slot = journal_copy_slot; // Where appends continue
+                journal_phase = JOURNAL_ERASE;
+                break;
+            }
+            journal_copy_cell = cell + 1;
+            value = journal_get(cell);
+            journal_tag = journal_make_tag(cell, value);
+            journal_phase = JOURNAL_COPY_TAG;
+            if (journal_write(journal_address(!journal_half, journal_copy_slot) + 1, value))
+                return;
+            break;
+
+        case JOURNAL_COPY_TAG:
+            journal_phase = JOURNAL_COPY;
+            if (journal_write(journal_address(!journal_half, journal_copy_slot++), journal_tag))
+                return;
+            break;
+
+        case JOURNAL_ERASE:
+            // Records left from older generations must not extend the new journal
+            if (journal_copy_slot >= JOURNAL_SLOTS)
+            {
+                journal_phase = JOURNAL_HEADER_VALUE;
+                break;
+            }
+            if (journal_write(journal_address(!journal_half, journal_copy_slot++), JOURNAL_END))
+                return;
+            break;
+
+        case JOURNAL_HEADER_VALUE:
+            journal_phase = JOURNAL_HEADER_TAG;
+            if (journal_write(journal_address(!journal_half, 0) + 1, journal_gen + 1))
+                return;
+            break;
+
+        case JOURNAL_HEADER_TAG:
+            // Writing the header tag commits the new half
+            journal_half = !journal_half;
+            journal_gen++;
+            journal_phase = JOURNAL_IDLE;
+            if (journal_write(journal_address(journal_half, 0), journal_make_tag(JOURNAL_HEADER, journal_gen)))
+                return;
+            break;
+        }
+    }
+}
+
+// Changes to text_buffer or rx_display_buffer go between journal_begin and
+// journal_end, so the writer never sees a half-updated string
+void journal_begin()
+{
+    disable_interrupts(INT_EEPROM);
+}
+
+// Schedule a changed cell for saving (between journal_begin and journal_end)
+void journal_mark(int8 cell)
+{
+    bit_set(journal_dirty[cell >> 3], cell & 7);
+}
+
+// Start writing the marked cells in the background
+void journal_end()
+{
+    disable_interrupts(GLOBAL);
+    if (!journal_busy)
+        journal_step();
+    enable_interrupts(INT_EEPROM);
+    enable_interrupts(GLOBAL);
+}
+
+// Mark the whole received message (up to its terminator)
+void journal_mark_rx()
 {
     int8 i, len;
-    len = read_eeprom(50);
+    len = strlen(rx_display_buffer);
     if (len > 20)
-        len = 0;
+        len = 20;
+    for (i = 0; i <= len; i++)
+        journal_mark(JOURNAL_RX + i);
+}
 
-    for (i = 0; i < len; i++)
+// Wait until every scheduled change is in EEPROM (before a reset)
+void journal_flush()
+{
+    while (journal_busy)
+        restart_wdt();
+}
+
+// Read a half's header; returns 0 if it has none
+int1 journal_header(int1 half, int8 *gen)
+{
+    int8 tag;
+    tag = read_eeprom(journal_address(half, 0));
+    *gen = read_eeprom(journal_address(half, 0) + 1);
+    return journal_record_valid(tag, *gen) && (tag & 0x7F) == JOURNAL_HEADER;
+}
+
+// Restore text_buffer and rx_display_buffer from the newest journal half.
+// Returns 0 if there is no journal yet (the old layout is imported instead).
+int1 journal_load()
+{
+    int8 slot, tag, value, gen_a, gen_b;
+    int1 valid_a, valid_b;
+
+    text_buffer[0] = '\0';
+    rx_display_buffer[0] = '\0';
+
+    valid_a = journal_header(0, &gen_a);
+    valid_b = journal_header(1, &gen_b);
+    if (!valid_a && !valid_b)
     {
-        rx_display_buffer[i] = read_eeprom(51 + i);
+        load_text_from_eeprom();
+        load_bt_from_eeprom();
+        journal_half = 1; // First save writes a full copy into half A
+        journal_gen = 0xFF;
+        journal_slot = JOURNAL_SLOTS;
+        return 0;
+    }
+
+    if (valid_a && valid_b)
+        journal_half = (signed char)(gen_b - gen_a) > 0;
+    else
+        journal_half = valid_b;
+    journal_gen = journal_half ? gen_b : gen_a;
+
+    // Replay the records in order, later ones win
+    for (slot = 1; slot < JOURNAL_SLOTS; slot++)
+    {
+        tag = read_eeprom(journal_address(journal_half, slot));
+        value = read_eeprom(journal_address(journal_half, slot) + 1);
+        if (!journal_record_valid(tag, value))
+            break;
+        journal_put(tag & 0x7F, value);
         restart_wdt();
     }
-    rx_display_buffer[len] = '\0';
+    journal_slot = slot;
+
+    text_buffer[20] = '\0';
+    text_index = strlen(text_buffer);
+    rx_display_buffer[20] = '\0';
+    return 1;
 }
 
-// Algorithm to convert dots/dashes string into a character
-char decode_morse(char *code)
+// Find the undelivered messages and the slot after the newest one
+void outbox_load()
 {
-    int8 i, len;
-    int8 index = 1;
-    len = strlen(code);
-    if (len == 0)
-        return ' ';
+    int8 slot, i, header, next, used = 0;
+    int1 newer;
 
-    for (i = 0; i < len; i++)
+    for (slot = 0; slot < OUTBOX_SLOTS; slot++)
     {
-        index = index << 1;
-        if (code[i] == '-')
-            index |= 1;
-        if (index >= 64)
-            return '?'; // Error/Unknown
+        header = read_eeprom(outbox_address(slot));
+        if (header == OUTBOX_UNUSED)
+            continue;
+        used |= 1 << slot;
+        outbox_seqs[slot] = header & 0x3F;
+        if (!(header & OUTBOX_DELIVERED))
+            outbox_pending |= 1 << slot;
+    }
+
+    // Slots hold consecutive numbers; the newest has no successor
+    for (slot = 0; slot < OUTBOX_SLOTS; slot++)
+    {
+        if (!(used & (1 << slot)))
+            continue;
+        next = outbox_seqs[slot] + 1;
+        if (next == OUTBOX_SEQ_LIMIT)
+            next = 0;
+        newer = 0;
+        for (i = 0; i < OUTBOX_SLOTS; i++)
+        {
+            if (i != slot && (used & (1 << i)) && outbox_seqs[i] == next)
+                newer = 1;
+        }
+        if (!newer)
+        {
+            outbox_seq = next;
+            outbox_head = slot + 1;
+            if (outbox_head == OUTBOX_SLOTS)
+                outbox_head = 0;
+        }
     }
-    if (morse_tree[index] == 0)
-        return '?';
-    return "morse_tree"[index];
+}
+
+// Character for the dots/dashes typed so far (one table lookup), 0 if the
+// code is unknown ('?' is a valid character now)
+char decode_morse()
+{
+    if (morse_index > MORSE_MAX_ELEMENTS)
+        return 0;
+    return morse_table[morse_node];
+}
+
+// Discard the dots/dashes typed so far
+void clear_morse()
+{
+    morse_index = 0;
+    morse_node = 1;
+    morse_buffer[0] = '\0';
+}
+
+// Gap commit thresholds from the dot average: 2.5 and 5 dots
+void keying_set_gaps()
+{
+    gap_char_ticks = (dot_estimate >> 3) + (dot_estimate >> 5);
+    gap_word_ticks = (dot_estimate >> 2) + (dot_estimate >> 4);
+}
+
+// Start the dot and dash averages from a speed in WPM
+void keying_set_wpm(int8 wpm)
+{
+    if (wpm < 4 || wpm > 60)
+        wpm = KEYING_DEFAULT_WPM;
+    dot_estimate = 1920 / wpm; // 1200 / WPM ms in ticks x 16
+    dash_estimate = dot_estimate * 3;
+    keying_set_gaps();
+}
+
+// Current speed in WPM from the dot average
+int8 keying_read_wpm()
+{
+    int16 dot;
+    disable_interrupts(INT_TIMER1);
+    dot = dot_estimate;
+    enable_interrupts(INT_TIMER1);
+    return 1920 / dot;
+}
+
+// Record a changed speed (between journal_begin and journal_end)
+void keying_save()
+{
+    int8 wpm = keying_read_wpm();
+    if (wpm != keying_wpm)
+    {
+        keying_wpm = wpm;
+        journal_mark(JOURNAL_WPM);
+    }
+}
+
+// Move a running average a quarter of the way towards a press (unsigned math)
+int16 keying_track(int16 estimate, int16 length)
+{
+    if (length > estimate)
+        return estimate + ((length - estimate) >> 2);
+    return estimate - ((estimate - length) >> 2);
+}
+
+// Sort a press of `ticks` into the dot or dash cluster and update that
+// cluster. A press far outside both clusters means the operator keys at a
+// very different speed than assumed: the clusters shift by one instead.
+// Dashes stay 2..4 dots long; when an update breaks that, the other cluster
+// is moved to 1:3 of the fresh one. Called from timer1_isr only.
+int1 keying_classify(int16 ticks)
+{
+    int16 length;
+    int1 is_dash;
+
+    if (ticks > KEYING_MAX_PRESS)
+        ticks = KEYING_MAX_PRESS;
+    length = ticks << 4;
+    is_dash = length >= (dot_estimate + dash_estimate) >> 1;
+
+    if (!is_dash && length < dot_estimate >> 1)
+    {
+        dash_estimate = dot_estimate; // Much faster: old dots were dashes
+        dot_estimate = length;
+    }
+    else if (is_dash && length > dash_estimate << 1)
+    {
+        dot_estimate = dash_estimate; // Much slower: old dashes were dots
+        dash_estimate = length;
+    }
+    else if (is_dash)
+    {
+        dash_estimate = keying_track(dash_estimate, length);
+        if (dash_estimate < dot_estimate << 1 || dash_estimate > dot_estimate << 2)
+            dot_estimate = dash_estimate / 3;
+    }
+    else
+    {
+        dot_estimate = keying_track(dot_estimate, length);
+        if (dash_estimate < dot_estimate << 1 || dash_estimate > dot_estimate << 2)
+            dash_estimate = dot_estimate * 3;
+    }
+    if (dot_estimate < KEYING_MIN_DOT)
+        dot_estimate = KEYING_MIN_DOT;
+
+    // Bounce filter: a quarter dot, between 1 and 2 ticks
+    keying_debounce = dot_estimate >> 6;
+    if (keying_debounce < 1)
+        keying_debounce = 1;
+    if (keying_debounce > 2)
+        keying_debounce = 2;
+    keying_set_gaps();
+    return is_dash;
 }
 
 // Function to position the cursor on the LCD (Handles memory addresses)
@@ -168,220 +826,749 @@ void lcd_locate(int8 x, int8 y)
     lcd_send_byte(0, 0x80 | address);
 }
 
+// The panel was cleared or re-initialized: it shows spaces, cursor at home
+void lcd_shadow_reset()
+{
+    memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+    lcd_cursor = 0;
+}
+
+// Clear the panel and the shadow together
+void lcd_clear()
+{
+    lcd_putc('\f');
+    lcd_shadow_reset();
+}
+
+// Start drawing at column x of row y (1-based, like lcd_locate)
+void lcd_draw_at(int8 x, int8 y)
+{
+    lcd_draw_end = y * LCD_COLS;
+    lcd_draw_pos = lcd_draw_end - LCD_COLS + x - 1;
+}
+
+// Draw one character; unchanged cells cost nothing on the LCD bus
+void lcd_shadow_putc(char c)
+{
+    int8 pos = lcd_draw_pos;
+    if (pos >= lcd_draw_end)
+        return; // Past the end of the row
+    lcd_draw_pos++;
+
+    if (lcd_shadow[pos] == c)
+        return;
+
+    if (lcd_cursor != pos)
+        lcd_locate(pos - (lcd_draw_end - LCD_COLS) + 1, lcd_draw_end / LCD_COLS);
+    lcd_send_byte(1, c);
+    lcd_shadow[pos] = c;
+
+    // DDRAM rows are not contiguous, the cursor leaves the row at its end
+    lcd_cursor = pos + 1;
+    if (lcd_cursor == lcd_draw_end)
+        lcd_cursor = LCD_CURSOR_UNKNOWN;
+}
+
+// Fill the rest of the row being drawn with spaces
+void lcd_draw_clear_eol()
+{
+    while (lcd_draw_pos < lcd_draw_end)
+        lcd_shadow_putc(' ');
+}
+
+// Blank the row being drawn up to (not including) column x
+void lcd_draw_pad_to(int8 x)
+{
+    int8 end = lcd_draw_end - LCD_COLS + x - 1;
+    while (lcd_draw_pos < end)
+        lcd_shadow_putc(' ');
+}
+
+// Clear the screen for a splash message (drawn by the caller at 1,1) that
+// stays up for `ticks` Timer1 ticks; screen updates wait until then
+void splash_begin(int8 ticks)
+{
+    lcd_clear();
+    lcd_draw_at(1, 1);
+    splash_ticks = ticks;
+}
+
+// Sound the buzzer for `ticks` Timer1 ticks without waiting
+void beep(int8 ticks)
+{
+    beep_ticks = ticks;
+    output_high(BUZZER_PIN);
+}
+
 // Scrolls the text received from Bluetooth on the 4th line
 void update_scroll_line()
 {
     int8 len, i, current_char_idx;
-    int8 gap_size = 4;
+    int8 period;
 
+    lcd_draw_at(1, 4);
     if (rx_display_buffer[0] == '\0')
     {
-        lcd_locate(1, 4);
-        printf(lcd_putc, "                    ");
+        lcd_draw_clear_eol();
         return;
     }
 
+    // The text repeats every len + 4 columns (4 spaces between copies)
     len = strlen(rx_display_buffer);
-    lcd_locate(1, 4);
+    period = len + 4;
+    while (scroll_pos >= period)
+        scroll_pos -= period;
 
-    for (i = 0; i < 20; i++)
+    current_char_idx = scroll_pos;
+    for (i = 0; i < LCD_COLS; i++)
     {
-        current_char_idx = (scroll_pos + i) % (len + gap_size);
         if (current_char_idx < len)
-            lcd_putc(rx_display_buffer[current_char_idx]);
+            lcd_shadow_putc(rx_display_buffer[current_char_idx]);
         else
-            lcd_putc(' ');
+            lcd_shadow_putc(' ');
+        if (++current_char_idx == period)
+            current_char_idx = 0;
     }
 }
 
-// Refresh the full LCD screen content
+// Refresh the LCD screen content (only changed characters reach the panel)
 void update_lcd()
 {
-    int8 i, len;
     char preview_char;
+    int8 i;
 
-    lcd_locate(1, 1);
-    // Display current mode (Message vs Command)
+    if (splash_ticks > 0)
+    {
+        update_needed = 1; // Drawn when the splash screen is over
+        return;
+    }
+
+    lcd_draw_at(1, 1);
+    // Display current mode (Message vs Command) and keying speed
     if (app_mode == 0)
-        printf(lcd_putc, "MODE: MESSAGE       ");
+        printf(lcd_shadow_putc, "MODE: MESSAGE");
     else
-        printf(lcd_putc, "MODE: COMMAND       ");
+        printf(lcd_shadow_putc, "MODE: COMMAND");
+    printf(lcd_shadow_putc, "  %2uWPM", keying_read_wpm());
+    lcd_draw_clear_eol();
 
-    lcd_locate(1, 2);
+    lcd_draw_at(1, 2);
     // Display current text message
-    printf(lcd_putc, "%s", text_buffer);
+    printf(lcd_shadow_putc, "%s", text_buffer);
 
     // Show preview of the character currently being typed
     if (morse_index > 0)
     {
-        preview_char = decode_morse(morse_buffer);
-        lcd_putc(preview_char);
-        lcd_putc('<');
+        preview_char = decode_morse();
+        if (preview_char == 0)
+            preview_char = MORSE_UNKNOWN_GLYPH;
+        lcd_shadow_putc(preview_char);
+        lcd_shadow_putc('<');
     }
-    else
+    lcd_draw_clear_eol();
+
+    lcd_draw_at(1, 3);
+    // Display current dots and dashes, and the commit mode
+    printf(lcd_shadow_putc, "%s", morse_buffer);
+    lcd_draw_pad_to(12);
+    i = (outbox_pending & 1) + ((outbox_pending >> 1) & 1) + ((outbox_pending >> 2) & 1);
+    if (i > 0)
+        printf(lcd_shadow_putc, "OUT%u", i); // Messages the desktop has not acked
+    lcd_draw_pad_to(17);
+    if (commit_auto)
+        printf(lcd_shadow_putc, "AUTO");
+    lcd_draw_clear_eol();
+
+    // Clear line 4 if empty (scroll function handles it otherwise)
+    if (rx_display_buffer[0] == '\0')
     {
-        lcd_putc("  ");
+        lcd_draw_at(1, 4);
+        lcd_draw_clear_eol();
     }
+}
+
+// Add the decoded character to text_buffer and start the next one
+void commit_character()
+{
+    char final_char;
 
-    // Clear the rest of the line
-    len = strlen(text_buffer) + (morse_index > 0 ? 2 : 0);
-    for (i = len; i < 20; i++)
-        lcd_putc(' ');
+    if (morse_index == 0)
+        return;
+    if (outbox_storing)
+    {
+        commit_pending = 1; // text_buffer is being copied to the outbox
+        return;
+    }
+    disable_interrupts(INT_TIMER1); // timer1_isr appends elements
+    final_char = decode_morse();
+    clear_morse();
+    enable_interrupts(INT_TIMER1);
 
-    lcd_locate(1, 3);
-    // Display current dots and dashes
-    printf(lcd_putc, "%s", morse_buffer);
-    len = strlen(morse_buffer);
-    for (i = len; i < 20; i++)
-        lcd_putc(' ');
+    if (text_index < 20 && final_char != 0)
+    {
+        journal_begin();
+        text_buffer[text_index++] = final_char;
+        text_buffer[text_index] = '\0';
+        journal_mark(JOURNAL_TEXT + text_index - 1);
+        journal_mark(JOURNAL_TEXT + text_index);
+        keying_save();
+        journal_end();
+    }
+    update_lcd();
+}
 
-    // Clear line 4 if empty (scroll function handles it otherwise)
-    if (rx_display_buffer[0] == '\0')
+// End the word with a space (once, and never at the start of the text)
+void commit_space()
+{
+    if (text_index == 0 || text_index >= 20 || text_buffer[text_index - 1] == ' ')
+        return;
+    if (outbox_storing)
     {
-        lcd_locate(1, 4);
-        printf(lcd_putc, "                    ");
+        space_pending = 1;
+        return;
     }
+    journal_begin();
+    text_buffer[text_index++] = ' ';
+    text_buffer[text_index] = '\0';
+    journal_mark(JOURNAL_TEXT + text_index - 1);
+    journal_mark(JOURNAL_TEXT + text_index);
+    journal_end();
+    update_lcd();
 }
 
-// Send data via Bluetooth (NMEA 0183 style format)
-void send_nmea_packet()
+// Queue one byte for the UART. Only waits if the ring is full.
+void tx_putc(char c)
 {
-    char type_char;
-    int8 checksum = 0;
-    int8 i, len;
-    char char_to_send;
+    int8 next = (tx_head + 1) & (TX_BUFFER_SIZE - 1);
+    while (next == tx_tail)
+        restart_wdt(); // INT_TBE is draining, a slot frees up within ~1 ms
 
-    if (app_mode == 0)
-        type_char = 'M'; // Message packet
-    else
-        type_char = 'K'; // Command packet
+    tx_buffer[tx_head] = c;
+    tx_head = next;
+    enable_interrupts(INT_TBE);
+}
 
-    fprintf(BT_MODULE, "$%c,", type_char);
-    checksum = type_char ^ ',';
+// Wait until every queued byte has been handed to the UART
+void tx_flush()
+{
+    while (tx_head != tx_tail)
+        restart_wdt();
+}
+
+// Send a short "$<type>,<text>*CS" reply to the desktop (always text framing)
+void send_nmea_reply(char type, char *text)
+{
+    int8 checksum;
+    int8 i;
 
-    len = strlen(text_buffer);
+    checksum = type ^ ',';
+    for (i = 0; text[i] != '\0'; i++)
+        checksum ^= text[i];
+    printf(tx_putc, "$%c,%s*%02X\r\n", type, text, checksum);
+}
+
+// Report the receive counters as "$S,ovf=..,long=..,err=.."
+void send_status_packet()
+{
+    char status[32];
+    int16 overflow, oversize;
+
+    // Both are written by serial_isr, read them in one piece
+    disable_interrupts(GLOBAL);
+    overflow = rx_overflow_count;
+    oversize = rx_oversize_count;
+    enable_interrupts(GLOBAL);
+
+    sprintf(status, "ovf=%lu,long=%lu,err=%lu", overflow, oversize, rx_error_count);
+    send_nmea_reply('S', status);
+}
+
+// CRC-16/CCITT-FALSE, one byte at a time (poly 0x1021)
+int16 crc16_update(int16 crc, int8 data)
+{
+    int8 bit;
+    crc ^= ((int16)data << 8);
+    for (bit = 0; bit < 8; bit++)
+    {
+        if (crc & 0x8000)
+            crc = (crc << 1) ^ 0x1021;
+        else
+            crc = crc << 1;
+    }
+    return crc;
+}
+
+// Send a frame: COBS/CRC-16 on a binary link, text otherwise. The len
+// payload bytes sit at frame[2]; frame needs len + 4 bytes, the type, length
+// and CRC are filled in around the payload. Payloads longer than
+// LINK_PAYLOAD_MAX go out as text either way, the desktop's binary frames
+// stop there.
+void send_frame(char type, char *frame, int8 len)
+{
+    int8 i, block, code;
+    int16 crc = 0xFFFF;
+
+    if (!link_binary || len > LINK_PAYLOAD_MAX)
+    {
+        frame[len + 2] = '\0';
+        send_nmea_reply(type, frame + 2);
+        return;
+    }
+
+    frame[0] = type;
+    frame[1] = len;
+    len += 2;
     for (i = 0; i < len; i++)
+        crc = crc16_update(crc, frame[i]);
+    frame[len++] = make8(crc, 1);
+    frame[len++] = make8(crc, 0);
+
+    // COBS: each block is a code byte (distance to the next zero) and its data
+    tx_putc(0);
+    block = 0;
+    while (block <= len)
     {
-        char_to_send = text_buffer[i];
-        // Replace spaces with commas in command mode
-        if (app_mode == 1 && char_to_send == ' ')
-            char_to_send = ',';
-        fputc(char_to_send, BT_MODULE);
-        checksum ^= char_to_send;
+        code = 1;
+        while (block + code - 1 < len && frame[block + code - 1] != 0)
+            code++;
+        tx_putc(code);
+        for (i = 1; i < code; i++)
+            tx_putc(frame[block + i - 1]);
+        block += code;
+    }
+    tx_putc(0);
+}
+
+// Send the message in an outbox slot, read back from EEPROM. Returns 0 if
+// the EEPROM is busy writing; the main loop tries again on its next pass.
+int1 outbox_send(int8 slot)
+{
+    char frame[OUTBOX_TEXT + 9]; // type, len, "62,K," + text, CRC
+    int8 header, address, len, i;
+    char c;
+
+    journal_begin();
+    if (journal_busy)
+    {
+        journal_end();
+        return 0;
+    }
+    address = outbox_address(slot);
+    header = read_eeprom(address);
+    sprintf(frame + 2, "%u,%c,", header & 0x3F, (header & OUTBOX_COMMAND) ? 'K' : 'M');
+    len = strlen(frame + 2);
+    for (i = 1; i <= OUTBOX_TEXT; i++)
+    {
+        c = read_eeprom(address + i);
+        if (c == '\0')
+            break;
+        frame[2 + len++] = c;
+    }
+    journal_end();
+
+    send_frame('Q', frame, len);
+    return 1;
+}
+
+// Start copying text_buffer into the next outbox slot. Returns 0 if the
+// outbox is full or still storing the previous message.
+int1 outbox_store()
+{
+    if (outbox_storing || (outbox_pending & (1 << outbox_head)))
+        return 0;
+
+    journal_begin();
+    outbox_release &= ~(1 << outbox_head); // The fill retires the old header itself
+    outbox_header = outbox_seq;
+    if (app_mode == 1)
+        outbox_header |= OUTBOX_COMMAND;
+    outbox_fill = OUTBOX_FILL_RETIRE;
+    journal_end();
+    outbox_storing = 1;
+    return 1;
+}
+
+// The desktop has message `seq`: its slot can be reused
+void outbox_ack(int8 seq)
+{
+    int8 slot, mask;
+
+    for (slot = 0; slot < OUTBOX_SLOTS; slot++)
+    {
+        mask = 1 << slot;
+        if ((outbox_pending & mask) && outbox_seqs[slot] == seq)
+        {
+            outbox_pending &= ~mask;
+            outbox_sent &= ~mask;
+            journal_begin();
+            outbox_release |= mask;
+            journal_end();
+            update_needed = 1;
+        }
+    }
+}
+
+// Main loop: finish a store, then send the oldest message the desktop has
+// not seen on this link. One frame at a time, so the TX ring never fills.
+void outbox_task()
+{
+    int8 i, slot, mask;
+
+    // The last byte is on its way: the slot is pending and the text is free
+    if (outbox_storing && outbox_fill == 0)
+    {
+        outbox_storing = 0;
+        outbox_seqs[outbox_head] = outbox_seq;
+        outbox_pending |= 1 << outbox_head;
+        if (++outbox_head == OUTBOX_SLOTS)
+            outbox_head = 0;
+        if (++outbox_seq == OUTBOX_SEQ_LIMIT)
+            outbox_seq = 0;
+
+        journal_begin();
+        text_index = 0;
+        text_buffer[0] = '\0';
+        journal_mark(JOURNAL_TEXT);
+        journal_end();
+        update_lcd();
+    }
+
+    if (link_ticks == 0 || tx_head != tx_tail)
+        return;
+    slot = outbox_head;
+    for (i = 0; i < OUTBOX_SLOTS; i++)
+    {
+        mask = 1 << slot;
+        if ((outbox_pending & mask) && !(outbox_sent & mask))
+        {
+            if (outbox_send(slot))
+            {
+                outbox_sent |= mask;
+                outbox_retry = OUTBOX_RETRY_TICKS;
+            }
+            return;
+        }
+        if (++slot == OUTBOX_SLOTS)
+            slot = 0;
     }
-    fprintf(BT_MODULE, "*%02X\r\n", checksum);
 }
 
 // Factory Reset: Wipes all data
 void full_wipe_reset()
 {
-    lcd_putc('\f');
-    lcd_locate(1, 1);
-    printf(lcd_putc, "DELETING ALL   "); // Feedback to user
-    output_high(BUZZER_PIN);
-    wdt_delay_ms(500);
-    output_low(BUZZER_PIN);
-
-    write_eeprom(0, 0);  // Clear text length
-    write_eeprom(50, 0); // Clear BT msg length
+    splash_begin(50);
+    printf(lcd_shadow_putc, "DELETING ALL"); // Feedback to user
+    beep(50);
 
+    journal_begin();
     text_index = 0;
     text_buffer[0] = '\0';
+    journal_mark(JOURNAL_TEXT);
+    rx_display_buffer[0] = '\0';
+    journal_mark(JOURNAL_RX);
+    outbox_release |= outbox_pending; // Undelivered messages go too
+    outbox_pending = 0;
+    outbox_sent = 0;
+    journal_end();
 
-    morse_index = 0;
-    morse_buffer[0] = '\0';
+    clear_morse();
+    scroll_pos = 0;
+
+    update_lcd();
+}
+
+// Show a received message on line 4. Only characters that differ from the
+// previous message are saved.
+void set_rx_display(char *text)
+{
+    int8 i, old_len;
 
+    old_len = strlen(rx_display_buffer);
+    i = strlen(text);
+    journal_begin();
+    do
+    {
+        // Past the old end the saved copy may not match RAM, so save those too
+        if (i > old_len || rx_display_buffer[i] != text[i])
+        {
+            rx_display_buffer[i] = text[i];
+            if (i <= 20)
+                journal_mark(JOURNAL_RX + i);
+        }
+    } while (i-- > 0);
+    journal_end();
+}
+
+// Blank line 4 and its saved copy
+void clear_rx_display()
+{
+    journal_begin();
     rx_display_buffer[0] = '\0';
+    journal_mark(JOURNAL_RX);
+    journal_end();
+}
+
+// Act on a received packet (type + payload), whatever framing it came in
+void handle_packet(char packet_type, char *payload, int8 len)
+{
+    int1 param_val = 0;
+    int8 i;
+    int8 comma_index = 255;
+
+    // Supported remote commands
+    char cmd_rst[] = "rst";
+    char cmd_led[] = "led_set";
+    char cmd_buz[] = "buzzer_set";
+    char cmd_hrst[] = "hard_reset";
+    char cmd_bin[] = "bin_set";
+    char reply_bin[] = "bin_ack";
+    char cmd_stat[] = "stat";
+    char cmd_hb[] = "hb";
+    char cmd_ack[] = "ack";
+    char cmd_nak[] = "nak";
+    char cmd_arq[] = "arq_set";
+    char reply_arq[] = "arq_ack";
+    int8 seq;
+
+    if (packet_type == 'M') // Text Message received
+    {
+        if (len > 24)
+            payload[24] = '\0'; // Longer than line 4 can scroll
+        set_rx_display(payload);
+    }
+    else if (packet_type == 'K') // Command received
+    {
+        // Parse parameters (e.g., cmd,1)
+        for (i = 0; i < len; i++)
+        {
+            if (payload[i] == ',')
+            {
+                comma_index = i;
+                break;
+            }
+        }
+
+        if (comma_index != 255)
+        {
+            payload[comma_index] = '\0';
+            if (payload[comma_index + 1] == '1')
+                param_val = 1;
+        }
+
+        // Link upkeep from the desktop: keeps the outbox sending, shows nothing
+        if (strcmp(payload, cmd_hb) == 0)
+        {
+            link_ticks = OUTBOX_LINK_TICKS;
+            return;
+        }
+        if (strcmp(payload, cmd_ack) == 0)
+        {
+            link_ticks = OUTBOX_LINK_TICKS;
+            if (comma_index != 255)
+            {
+                seq = 0;
+                for (i = comma_index + 1; i < len && payload[i] >= '0' && payload[i] <= '9'; i++)
+                    seq = seq * 10 + (payload[i] - '0');
+                outbox_ack(seq);
+            }
+            return;
+        }
+        if (strcmp(payload, cmd_nak) == 0)
+        {
+            outbox_sent = 0; // A frame of ours arrived damaged: resend the outbox now
+            return;
+        }
+
+        // Execute remote commands
+        if (strcmp(payload, cmd_rst) == 0)
+        {
+            journal_flush();
+            reset_cpu();
+        }
+        else if (strcmp(payload, cmd_led) == 0)
+        {
+            if (param_val) output_high(LED_PIN);
+            else output_low(LED_PIN);
+            clear_rx_display();
+        }
+        else if (strcmp(payload, cmd_buz) == 0)
+        {
+            if (param_val) output_high(BUZZER_PIN);
+            else output_low(BUZZER_PIN);
+            clear_rx_display();
+        }
+        else if (strcmp(payload, cmd_hrst) == 0)
+        {
+            full_wipe_reset();
+            journal_flush();
+            reset_cpu();
+        }
+        else if (strcmp(payload, cmd_bin) == 0)
+        {
+            // Acknowledge in text, then switch what we send
+            send_nmea_reply('K', reply_bin);
+            link_binary = param_val;
+            clear_rx_display();
+        }
+        else if (strcmp(payload, cmd_arq) == 0)
+        {
+            // New link: the desktop numbers its packets from 0
+            send_nmea_reply('K', reply_arq);
+            link_arq = param_val;
+            arq_next = 0;
+            arq_seen = 0;
+            clear_rx_display();
+        }
+        else if (strcmp(payload, cmd_stat) == 0)
+        {
+            send_status_packet();
+            clear_rx_display();
+        }
+        else
+        {
+            journal_begin();
+            strcpy(rx_display_buffer, "UNKNOWN CMD");
+            journal_mark_rx();
+            journal_end();
+        }
+    }
     scroll_pos = 0;
+    idle_counter = 0;
+}
+
+// With reliable delivery, ask for the oldest missing packet again (the
+// frame just lost, or one lost before it)
+void rx_request_resend()
+{
+    char reply[4];
+
+    if (!link_arq)
+        return;
+    sprintf(reply, "%u", arq_next);
+    send_nmea_reply('N', reply);
+}
+
+// Drop a damaged frame
+void rx_reject()
+{
+    rx_error_count++;
+    rx_request_resend();
+}
+
+// Act on a received frame: reliable "D" frames are acked and unwrapped
+// first, repeats of packets already handled are dropped
+void handle_frame(char packet_type, char *payload, int8 len)
+{
+    char reply[4];
+    int8 seq = 0, i = 0, offset, shift;
+
+    if (packet_type != 'D')
+    {
+        handle_packet(packet_type, payload, len);
+        return;
+    }
+
+    while (i < len && payload[i] >= '0' && payload[i] <= '9')
+        seq = seq * 10 + (payload[i++] - '0');
+    if (i == 0 || i + 3 > len || payload[i] != ',' || payload[i + 2] != ',' || seq >= ARQ_SEQ_LIMIT)
+    {
+        rx_reject();
+        return;
+    }
+
+    // Ack every copy: the ack of the first one may have been lost
+    sprintf(reply, "%u", seq);
+    send_nmea_reply('A', reply);
+
+    if (!link_arq)
+    {
+        // We were reset while the desktop kept sending: take its numbering
+        link_arq = 1;
+        arq_next = seq;
+        arq_seen = 0;
+    }
+    offset = (seq - arq_next) & (ARQ_SEQ_LIMIT - 1);
+    if (offset >= ARQ_SEQ_LIMIT / 2)
+        return; // Behind the window: handled already
+    if (offset >= ARQ_TRACKED)
+    {
+        // The desktop gave up on the oldest numbers: make seq the last tracked one
+        shift = offset - (ARQ_TRACKED - 1);
+        if (shift < ARQ_TRACKED)
+            arq_seen >>= shift;
+        else
+            arq_seen = 0;
+        arq_next = (arq_next + shift) & (ARQ_SEQ_LIMIT - 1);
+        offset = ARQ_TRACKED - 1;
+    }
+    if (arq_seen & (1 << offset))
+        return; // Handled already
+    arq_seen |= 1 << offset;
+    while (arq_seen & 1)
+    {
+        arq_seen >>= 1;
+        arq_next = (arq_next + 1) & (ARQ_SEQ_LIMIT - 1);
+    }
 
-    lcd_putc('\f');
-    update_lcd();
+    handle_packet(payload[i + 1], payload + i + 3, len - i - 3);
 }
 
-// Process incoming Bluetooth NMEA packets
-void process_incoming_nmea()
+// Process an incoming NMEA packet taken from the receive queue
+void process_incoming_nmea(char *frame)
 {
     char *ptr_start;
     char *ptr_end;
-    int8 len;
-    char packet_type;
-    char payload[25];
-    int1 param_val = 0;
-    int8 i;
-    int8 comma_index = 255;
-
-    // Supported remote commands
-    char cmd_rst[] = "rst";
-    char cmd_led[] = "led_set";
-    char cmd_buz[] = "buzzer_set";
-    char cmd_hrst[] = "hard_reset";
+    char *p;
+    int8 len, checksum, received, digits;
+    char packet_type, c;
+    char payload[LINK_PAYLOAD_MAX + 1];
 
-    if (rx_temp_buffer[0] == '$')
+    if (frame[0] == '$')
     {
-        packet_type = rx_temp_buffer[1];
-        ptr_start = strchr(rx_temp_buffer, ',');
-        ptr_end = strchr(rx_temp_buffer, '*');
+        packet_type = frame[1];
+        ptr_start = strchr(frame, ',');
+        ptr_end = strchr(frame, '*');
 
         // Check if packet format is valid ($...*)
         if (ptr_start != 0 && ptr_end != 0 && ptr_end > ptr_start)
         {
-            len = (int8)(ptr_end - ptr_start) - 1;
-            if (len > 24)
-                len = 24;
-
-            strncpy(payload, ptr_start + 1, len);
-            payload[len] = '\0';
-
-            if (packet_type == 'M') // Text Message received
+            // XOR of everything between '$' and '*', sent as one or two hex digits
+            checksum = 0;
+            for (p = frame + 1; p < ptr_end; p++)
+                checksum ^= *p;
+            received = 0;
+            digits = 0;
+            for (p = ptr_end + 1; *p != '\0'; p++)
             {
-                strcpy(rx_display_buffer, payload);
+                c = *p;
+                if (c >= '0' && c <= '9')
+                    c -= '0';
+                else if (c >= 'A' && c <= 'F')
+                    c -= 'A' - 10;
+                else if (c >= 'a' && c <= 'f')
+                    c -= 'a' - 10;
+                else
+                    break;
+                received = (received << 4) | c;
+                digits++;
             }
-            else if (packet_type == 'K') // Command received
+            if (digits == 0 || digits > 2 || received != checksum)
             {
-                // Parse parameters (e.g., cmd,1)
-                for (i = 0; i < len; i++)
-                {
-                    if (payload[i] == ',')
-                    {
-                        comma_index = i;
-                        break;
-                    }
-                }
-
-                if (comma_index != 255)
-                {
-                    payload[comma_index] = '\0';
-                    if (payload[comma_index + 1] == '1')
-                        param_val = 1;
-                }
+                rx_reject();
+                return;
+            }
 
-                // Execute remote commands
-                if (strcmp(payload, cmd_rst) == 0)
-                {
-                    reset_cpu();
-                }
-                else if (strcmp(payload, cmd_led) == 0)
-                {
-                    if (param_val) output_high(LED_PIN);
-                    else output_low(LED_PIN);
-                    rx_display_buffer[0] = '\0';
-                }
-                else if (strcmp(payload, cmd_buz) == 0)
-                {
-                    if (param_val) output_high(BUZZER_PIN);
-                    else output_low(BUZZER_PIN);
-                    rx_display_buffer[0] = '\0';
-                }
-                else if (strcmp(payload, cmd_hrst) == 0)
-                {
-                    full_wipe_reset();
-                    reset_cpu();
-                }
-                else
-                {
-                    strcpy(rx_display_buffer, "UNKNOWN CMD");
-                }
+            len = (int8)(ptr_end - ptr_start) - 1;
+            if (len > LINK_PAYLOAD_MAX)
+            {
+                rx_reject(); // Only fits with a one-digit checksum, never sent
+                return;
             }
+
+            strncpy(payload, ptr_start + 1, len);
+            payload[len] = '\0';
+            handle_frame(packet_type, payload, len);
+            return;
         }
         else
         {
@@ -389,16 +1576,98 @@ void process_incoming_nmea()
                 strcpy(rx_display_buffer, "FORMAT ERROR");
         }
     }
+    rx_reject();
     scroll_pos = 0;
 }
 
+// Process a COBS frame taken from the receive queue: decode in place, check CRC
+void process_incoming_binary(char *frame, int8 length)
+{
+    int8 read_pos = 0, write_pos = 0;
+    int8 code, i, len;
+    int16 crc = 0xFFFF;
+
+    while (read_pos < length)
+    {
+        code = frame[read_pos++];
+        if (code == 0 || read_pos + code - 1 > length)
+        {
+            rx_reject(); // Not valid COBS, drop it
+            return;
+        }
+        for (i = 1; i < code; i++)
+            frame[write_pos++] = frame[read_pos++];
+        if (read_pos < length)
+            frame[write_pos++] = 0;
+    }
+
+    // type + len + payload + crc
+    len = frame[1];
+    if (write_pos < 4 || len != write_pos - 4 || len > LINK_PAYLOAD_MAX)
+    {
+        rx_reject();
+        return;
+    }
+
+    for (i = 0; i < len + 2; i++)
+        crc = crc16_update(crc, frame[i]);
+    if (make8(crc, 1) != frame[len + 2] || make8(crc, 0) != frame[len + 3])
+    {
+        rx_reject();
+        return;
+    }
+
+    frame[len + 2] = '\0';
+    handle_frame(frame[0], frame + 2, len);
+}
+
+// Drain the receive queue. Returns 1 if at least one frame was handled.
+int1 process_rx_queue()
+{
+    int1 handled = 0;
+    int8 length;
+    char *frame;
+
+    while (rx_tail != rx_head)
+    {
+        frame = rx_frames[rx_tail];
+        length = rx_lengths[rx_tail];
+        if ((length & ~RX_BINARY_FLAG) >= RX_SLOT_SIZE)
+        {
+            rx_request_resend(); // Too long, counted by the ISR
+        }
+        else if (length & RX_BINARY_FLAG)
+        {
+            process_incoming_binary(frame, length & ~RX_BINARY_FLAG);
+        }
+        else
+        {
+            frame[length] = '\0';
+            process_incoming_nmea(frame);
+        }
+        handled = 1;
+
+        // Hand the slot back to the ISR only after we are done with it
+        if (rx_tail == RX_SLOTS - 1)
+            rx_tail = 0;
+        else
+            rx_tail++;
+    }
+    return handled;
+}
+
+// Announce sleep; the main loop sleeps when the splash is over
+void request_sleep()
+{
+    splash_begin(50);
+    printf(lcd_shadow_putc, "SLEEP MODE...");
+    sleep_pending = 1;
+}
+
 // Enter Low Power Sleep Mode
 void enter_sleep_mode()
 {
-    lcd_putc('\f');
-    lcd_locate(1, 1);
-    printf(lcd_putc, "SLEEP MODE...");
-    wdt_delay_ms(500);
+    tx_flush(); // The UART stops in sleep (the main loop waits for it to drain)
     lcd_send_byte(0, 0x08); // Turn off LCD
 
     output_low(LED_PIN);
@@ -409,24 +1678,62 @@ void enter_sleep_mode()
         restart_wdt();
         sleep(); // CPU Sleep
 
-        // Wake up if any button is pressed
+        // Wake up if any button is pressed (button_poll debounces it afterwards)
         if (!input(BTN_SIGNAL) || !input(BTN_UPLOAD) || !input(BTN_DELETE) || !input(BTN_RESET) || !input(BTN_MODE))
-        {
-            delay_ms(20); // Debounce
-            if (!input(BTN_SIGNAL) || !input(BTN_UPLOAD) || !input(BTN_DELETE) || !input(BTN_RESET) || !input(BTN_MODE))
-            {
-                break;
-            }
-        }
+            break;
     }
 
-    lcd_init(); // Re-init LCD
+    lcd_send_byte(0, 0x0C); // Turn the LCD back on, it kept its contents (and the shadow)
     update_lcd();
     idle_counter = 0;
 }
 
+// Publish the slot being filled as a complete frame (serial_isr only)
+void rx_commit(int8 length)
+{
+    int8 next;
+
+    rx_temp_index = 0;
+    if ((length & ~RX_BINARY_FLAG) >= RX_SLOT_SIZE)
+    {
+        // Marked too long while receiving, already counted. Only queued
+        // with reliable delivery, so the main loop can ask for it again.
+        if (!link_arq)
+            return;
+        length = RX_SLOT_SIZE;
+    }
+
+    next = rx_head + 1;
+    if (next == RX_SLOTS)
+        next = 0;
+    if (next == rx_tail)
+    {
+        rx_overflow_count++; // Queue full: keep the slot, drop this frame
+        return;
+    }
+    rx_lengths[rx_head] = length;
+    rx_head = next;
+}
+
+// Store one byte of the frame being received; the last byte of a slot is
+// kept free for the terminating '\0' of text frames
+void rx_store(char incoming)
+{
+    if (rx_temp_index < RX_SLOT_SIZE - 1)
+    {
+        rx_frames[rx_head][rx_temp_index++] = incoming;
+    }
+    else if (rx_temp_index == RX_SLOT_SIZE - 1)
+    {
+        rx_oversize_count++;
+        rx_temp_index = RX_SLOT_SIZE; // Ignore the rest of this frame
+    }
+}
+
 // Interrupt: Bluetooth Data Received (UART)
+#ifdef __PCM__
 #INT_RDA
+#endif
 void serial_isr()
 {
     char incoming;
@@ -434,31 +1741,74 @@ void serial_isr()
     {
         incoming = fgetc(BT_MODULE);
 
+        if (incoming == 0) // Binary frame delimiter
+        {
+            if (rx_in_binary && rx_temp_index > 0)
+                rx_commit(rx_temp_index | RX_BINARY_FLAG);
+            rx_in_binary = 1;
+            rx_temp_index = 0;
+            return;
+        }
+
+        // COBS data never starts with '$', so '$' right after 0x00 is text
+        if (rx_in_binary && (rx_temp_index > 0 || incoming != '$'))
+        {
+            rx_store(incoming);
+            return;
+        }
+
         if (incoming == '$') // Start of packet
         {
+            rx_in_binary = 0;
             rx_temp_index = 0;
         }
         if (incoming == '\n' || incoming == '\r') // End of packet
         {
-            rx_temp_buffer[rx_temp_index] = '\0';
-            rx_data_ready = 1;
+            if (rx_temp_index > 0)
+                rx_commit(rx_temp_index);
         }
         else
         {
-            if (rx_temp_index < 38)
-            {
-                rx_temp_buffer[rx_temp_index] = incoming;
-                rx_temp_index++;
-            }
+            rx_store(incoming);
         }
     }
 }
 
+// Interrupt: UART transmit register empty, sends the next queued byte
+#ifdef __PCM__
+#INT_TBE
+#endif
+void serial_tx_isr()
+{
+    if (tx_tail != tx_head)
+    {
+        fputc(tx_buffer[tx_tail], BT_MODULE);
+        tx_tail = (tx_tail + 1) & (TX_BUFFER_SIZE - 1);
+    }
+    if (tx_tail == tx_head)
+        disable_interrupts(INT_TBE); // Nothing left, stop the interrupt
+}
+
+// Interrupt: data EEPROM write finished, start the next journal write
+#ifdef __PCM__
+#INT_EEPROM
+#endif
+void eeprom_isr()
+{
+    journal_busy = 0;
+    journal_step();
+}
+
 // Interrupt: Timer1 (Handles Morse Input Timing)
+#ifdef __PCM__
 #INT_TIMER1
+#endif
 void timer1_isr()
 {
     set_timer1(63036);
+    tick_count++;
+    if (beep_ticks > 0)
+        beep_ticks--;
     if (idle_counter < 32000)
         idle_counter++;
 
@@ -468,38 +1818,60 @@ void timer1_isr()
     {
         idle_counter = 0;
         press_counter++; // Increment while button is held
+        gap_counter = 0;
+        gap_stage = GAP_ELEMENT;
         output_high(LED_PIN);
         output_high(BUZZER_PIN);
     }
     else
     {
         output_low(LED_PIN);
-        output_low(BUZZER_PIN);
+        if (beep_ticks == 0)
+            output_low(BUZZER_PIN);
         if (btn_prev_state == 1) // Button released
         {
             idle_counter = 0;
-            if (press_counter > 2)
+            if (press_counter > keying_debounce)
             {
-                // Determine if it was a Dot or Dash based on duration
-                if (press_counter < 30)
-                    morse_buffer[morse_index++] = '.';
-                else
-                    morse_buffer[morse_index++] = '-';
-
-                if (morse_index > 9)
-                    morse_index = 9;
+                // Determine if it was a Dot or Dash against the operator's speed
+                int1 is_dash = keying_classify(press_counter);
+                if (morse_index < 9)
+                {
+                    morse_buffer[morse_index++] = is_dash ? '-' : '.';
+                    morse_buffer[morse_index] = '\0';
 
-                morse_buffer[morse_index] = '\0';
+                    // Walk down the table as each element arrives
+                    if (morse_index <= MORSE_MAX_ELEMENTS)
+                        morse_node = (morse_node << 1) | is_dash;
+                }
                 update_needed = 1;
             }
             press_counter = 0;
         }
+
+        // Gap commit mode: a short silence ends the character, a longer one the word
+        if (commit_auto && gap_stage != GAP_WORD)
+        {
+            gap_counter++;
+            if (gap_stage == GAP_ELEMENT && gap_counter >= gap_char_ticks)
+            {
+                gap_stage = morse_index > 0 ? GAP_CHARACTER : GAP_WORD;
+                commit_pending = morse_index > 0;
+            }
+            else if (gap_stage == GAP_CHARACTER && gap_counter >= gap_word_ticks)
+            {
+                gap_stage = GAP_WORD;
+                space_pending = 1;
+            }
+        }
     }
     btn_prev_state = btn_current;
 }
 
 // Interrupt: Timer0 (Handles Text Scrolling Speed)
+#ifdef __PCM__
 #INT_TIMER0
+#endif
 void timer0_isr()
 {
     scroll_tick++;
@@ -510,9 +1882,178 @@ void timer0_isr()
     }
 }
 
+// Debounce one button and turn its state into an event (once per tick).
+// long_ticks = 0: the button has no long press.
+int8 button_poll(int8 index, int8 pin, int8 long_ticks)
+{
+    int8 mask = 1 << index;
+    int1 pressed = !input(pin);
+
+    if (pressed == ((button_down & mask) != 0))
+    {
+        button_bounce[index] = 0;
+    }
+    else if (++button_bounce[index] >= BUTTON_DEBOUNCE)
+    {
+        button_bounce[index] = 0;
+        if (pressed)
+        {
+            button_down |= mask;
+            button_held[index] = 0;
+            idle_counter = 0;
+            return BTN_EV_PRESS;
+        }
+        button_down &= ~mask;
+        if (button_done & mask)
+        {
+            button_done &= ~mask;
+            return BTN_EV_RELEASE;
+        }
+        return BTN_EV_SHORT;
+    }
+
+    if ((button_down & mask) && !(button_done & mask))
+    {
+        button_held[index]++;
+        if (long_ticks && button_held[index] >= long_ticks)
+        {
+            button_done |= mask;
+            return BTN_EV_LONG;
+        }
+    }
+    return BTN_EV_NONE;
+}
+
+// Timed work of the main loop, once per Timer1 tick. Nothing here waits.
+void scheduler_tick()
+{
+    int8 upload, del, reset, mode;
+
+    // Splash screens, and the sleep announced by one
+    if (splash_ticks > 0)
+    {
+        if (--splash_ticks == 0 && !sleep_pending)
+            update_needed = 1;
+    }
+    else if (sleep_pending && tx_head == tx_tail)
+    {
+        sleep_pending = 0;
+        enter_sleep_mode();
+    }
+
+    // Outbox: the link is up while heartbeats arrive; resend what is not acked
+    if (link_ticks > 0 && --link_ticks == 0)
+        outbox_sent = 0;
+    if (outbox_retry > 0 && --outbox_retry == 0)
+        outbox_sent = 0;
+
+    upload = button_poll(BUTTON_UPLOAD, BTN_UPLOAD, 50);
+    del = button_poll(BUTTON_DELETE, BTN_DELETE, 0);
+    reset = button_poll(BUTTON_RESET, BTN_RESET, 200);
+    mode = button_poll(BUTTON_MODE, BTN_MODE, 100);
+    if (button_down)
+        idle_counter = 0; // A held button is activity
+
+    // Shortcut: Force Sleep (Mode + Reset); both only report their release now
+    if ((button_down & BUTTON_SLEEP_COMBO) == BUTTON_SLEEP_COMBO && (button_done & BUTTON_SLEEP_COMBO) != BUTTON_SLEEP_COMBO)
+    {
+        button_done |= BUTTON_SLEEP_COMBO;
+        reset = BTN_EV_NONE;
+        mode = BTN_EV_NONE;
+        if (!sleep_pending)
+            request_sleep();
+    }
+
+    // Upload Button: short press adds the decoded char, long press sends
+    // through the outbox (the text is cleared once it is stored)
+    if (upload == BTN_EV_SHORT)
+    {
+        commit_character();
+    }
+    else if (upload == BTN_EV_LONG && !outbox_storing)
+    {
+        if (text_index > 0 && text_buffer[text_index - 1] == ' ')
+        {
+            journal_begin();
+            text_buffer[--text_index] = '\0'; // Word gap after the last word
+            journal_mark(JOURNAL_TEXT + text_index);
+            journal_end();
+        }
+        clear_morse();
+
+        splash_begin(100);
+        if (text_index > 0 && !outbox_store())
+        {
+            printf(lcd_shadow_putc, "OUTBOX FULL"); // Text kept, send it later
+        }
+        else
+        {
+            if (text_index > 0)
+                beep(10);
+            if (text_index > 0 && link_ticks == 0)
+                printf(lcd_shadow_putc, "DATA QUEUED"); // Sent when the desktop is back
+            else
+                printf(lcd_shadow_putc, "DATA SENT"); // English feedback
+        }
+    }
+
+    // Delete Button (Backspace)
+    if (del == BTN_EV_PRESS && !outbox_storing)
+    {
+        if (morse_index > 0)
+        {
+            morse_buffer[--morse_index] = '\0'; // Remove dot/dash
+            if (morse_index < MORSE_MAX_ELEMENTS)
+                morse_node >>= 1; // Back up one level in the table
+        }
+        else if (text_index > 0)
+        {
+            journal_begin();
+            text_buffer[--text_index] = '\0'; // Remove character
+            journal_mark(JOURNAL_TEXT + text_index);
+            journal_end();
+        }
+        update_lcd();
+    }
+
+    // Reset Button: short press clears the text, long press (2 s) wipes all
+    if (reset == BTN_EV_SHORT && !outbox_storing)
+    {
+        journal_begin();
+        text_index = 0;
+        text_buffer[0] = '\0';
+        journal_mark(JOURNAL_TEXT);
+        journal_end();
+        clear_morse();
+        update_lcd();
+    }
+    else if (reset == BTN_EV_LONG)
+    {
+        full_wipe_reset();
+    }
+
+    // Mode Button: short press Message <-> Command, long press (1 s)
+    // switches between explicit and gap commit
+    if (mode == BTN_EV_SHORT)
+    {
+        app_mode = !app_mode;
+        update_lcd();
+    }
+    else if (mode == BTN_EV_LONG)
+    {
+        journal_begin();
+        commit_auto = !commit_auto;
+        journal_mark(JOURNAL_COMMIT);
+        journal_end();
+        update_lcd();
+    }
+}
+
 // --- Main Program ---
 void main()
 {
+    int1 journal_ready;
+
     setup_oscillator(OSC_8MHZ); // Set clock to 8MHz
 
     setup_wdt(WDT_OFF); // Disable WDT initially
@@ -522,17 +2063,14 @@ void main()
     output_drive(LED_PIN);
     output_drive(BUZZER_PIN);
 
-    // Startup beep
-    output_high(BUZZER_PIN);
-    delay_ms(50);
-    output_low(BUZZER_PIN);
-
     lcd_init();
+    lcd_shadow_reset();
     delay_ms(100);
 
     // Restore data from memory
-    load_text_from_eeprom();
-    load_bt_from_eeprom();
+    journal_ready = journal_load();
+    keying_set_wpm(keying_wpm);
+    outbox_load();
 
     // Timer Setup
     setup_timer_1(T1_INTERNAL | T1_DIV_BY_8);
@@ -543,26 +2081,41 @@ void main()
     enable_interrupts(INT_TIMER1);
     enable_interrupts(INT_TIMER0);
     enable_interrupts(INT_RDA);
+    enable_interrupts(INT_EEPROM);
     enable_interrupts(GLOBAL);
 
-    lcd_locate(1, 1);
-    printf(lcd_putc, "Morse Telegraph"); // English Title
-    delay_ms(1000);
+    if (!journal_ready)
+    {
+        journal_begin(); // Start the journal with a full copy
+        journal_mark(JOURNAL_TEXT);
+        journal_end();
+    }
 
-    lcd_putc('\f');
-    update_lcd();
+    beep(5); // Startup beep
+    splash_begin(100);
+    printf(lcd_shadow_putc, "Morse Telegraph"); // English Title
 
     setup_wdt(WDT_2304MS); // Enable Watchdog
 
     while (TRUE)
     {
         restart_wdt();
+#ifndef __PCM__
+        sim_loop_mark(); // Main-loop latency probe
+#endif
+
+        // Timed work, once per Timer1 tick
+        if (tick_seen != tick_count)
+        {
+            tick_seen = tick_count;
+            scheduler_tick();
+        }
 
         // Handle scrolling text
         if (scroll_now)
         {
             scroll_now = 0;
-            if (rx_display_buffer[0] != '\0')
+            if (rx_display_buffer[0] != '\0' && splash_ticks == 0)
             {
                 scroll_pos++;
                 update_scroll_line();
@@ -570,169 +2123,35 @@ void main()
         }
 
         // Handle incoming Bluetooth data
-        if (rx_data_ready)
-        {
-            process_incoming_nmea();
-            save_bt_to_eeprom();
-            rx_data_ready = 0;
-            update_lcd();
-            idle_counter = 0;
-        }
-
-        // Check for inactivity sleep
-        if (idle_counter > SLEEP_TIMEOUT)
-        {
-            enter_sleep_mode();
-        }
-
-        // Update LCD if needed
-        if (update_needed)
-        {
+        if (process_rx_queue())
             update_lcd();
-            update_needed = 0;
-        }
 
-        // Shortcut: Force Sleep (Mode + Reset)
-        if (!input(BTN_MODE) && !input(BTN_RESET))
-        {
-            delay_ms(50);
-            if (!input(BTN_MODE) && !input(BTN_RESET))
-            {
-                enter_sleep_mode();
-                while (!input(BTN_MODE) || !input(BTN_RESET))
-                    restart_wdt();
-            }
-        }
+        // Store-and-forward outbox
+        outbox_task();
 
-        // Switch Mode (Mode pressed, Reset released)
-        if (!input(BTN_MODE) && input(BTN_RESET))
+        // Check for inactivity sleep
+        if (idle_counter > SLEEP_TIMEOUT && !sleep_pending)
         {
-            idle_counter = 0;
-            delay_ms(50);
-            if (!input(BTN_MODE))
-            {
-                app_mode = !app_mode;
-                update_lcd();
-                while (!input(BTN_MODE))
-                    restart_wdt();
-            }
+            request_sleep();
         }
 
-        // Upload Button Logic
-        if (!input(BTN_UPLOAD))
+        // Gap commit mode: timer1_isr saw the end of a character or word
+        if (commit_pending)
         {
-            idle_counter = 0;
-            int16 hold_counter = 0;
-
-            // Detect long press vs short press
-            while (!input(BTN_UPLOAD) && hold_counter < 50)
-            {
-                delay_ms(10);
-                restart_wdt();
-                hold_counter++;
-            }
-
-            // Long Press: Send Message
-            if (hold_counter >= 50)
-            {
-                if (text_index > 0)
-                {
-                    send_nmea_packet();
-                    output_high(BUZZER_PIN);
-                    wdt_delay_ms(100);
-                    output_low(BUZZER_PIN);
-                }
-                while (!input(BTN_UPLOAD))
-                    restart_wdt();
-
-                // Clear buffers
-                text_index = 0;
-                text_buffer[0] = '\0';
-                morse_index = 0;
-                morse_buffer[0] = '\0';
-                save_text_to_eeprom();
-
-                lcd_putc('\f');
-                lcd_locate(1, 1);
-                printf(lcd_putc, "DATA SENT"); // English feedback
-                wdt_delay_ms(1000);
-                lcd_putc('\f');
-                update_lcd();
-            }
-            // Short Press: Add decoded char to text
-            else
-            {
-                while (!input(BTN_UPLOAD))
-                    restart_wdt();
-                if (morse_index > 0)
-                {
-                    char final_char = decode_morse(morse_buffer);
-                    if (text_index < 20 && final_char != '?')
-                    {
-                        text_buffer[text_index++] = final_char;
-                        text_buffer[text_index] = '\0';
-                        save_text_to_eeprom();
-                    }
-                    morse_index = 0;
-                    morse_buffer[0] = '\0';
-                    update_lcd();
-                }
-            }
+            commit_pending = 0;
+            commit_character();
         }
-
-        // Delete Button (Backspace)
-        if (!input(BTN_DELETE))
+        if (space_pending)
         {
-            delay_ms(20);
-            if (!input(BTN_DELETE))
-            {
-                idle_counter = 0;
-                if (morse_index > 0)
-                    morse_buffer[--morse_index] = '\0'; // Remove dot/dash
-                else if (text_index > 0)
-                {
-                    text_buffer[--text_index] = '\0'; // Remove character
-                    save_text_to_eeprom();
-                }
-                update_lcd();
-                while (!input(BTN_DELETE))
-                    restart_wdt();
-            }
+            space_pending = 0;
+            commit_space();
         }
 
-        // Reset Button
-        if (!input(BTN_RESET) && input(BTN_MODE))
+        // Update LCD if needed
+        if (update_needed)
         {
-            idle_counter = 0;
-            int16 reset_hold = 0;
-
-            while (!input(BTN_RESET))
-            {
-                delay_ms(10);
-                restart_wdt();
-                reset_hold++;
-
-                // Long Press: Factory Reset
-                if (reset_hold > 200)
-                {
-                    full_wipe_reset();
-                    while (!input(BTN_RESET))
-                        restart_wdt();
-                    break;
-                }
-            }
-
-            // Short Press: Clear current text
-            if (reset_hold > 5 && reset_hold <= 200)
-            {
-                text_index = 0;
-                text_buffer[0] = '\0';
-                morse_index = 0;
-                morse_buffer[0] = '\0';
-                update_lcd();
-                while (!input(BTN_RESET))
-                    restart_wdt();
-            }
+            update_needed = 0;
+            update_lcd();
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,522 @@
+// Mock HAL and event engine. Every HAL call advances simulated time by its
+// cost on the real part; pending interrupts are dispatched in between, in
+// the order the CCS dispatcher checks them.
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include "hal.h"
+#include "sim.h"
+
+#undef printf
+#undef sprintf
+
+// CCS handlers in main.c
+void serial_isr(void);
+void serial_tx_isr(void);
+void eeprom_isr(void);
+void timer1_isr(void);
+void timer0_isr(void);
+void firmware_main(void);
+
+// Costs in microseconds (8 MHz clock, 0.5 us per instruction)
+#define COST_IO_US 1
+#define COST_ISR_ENTRY_US 20        // Context save/restore of the CCS dispatcher
+#define COST_LCD_BYTE_US 50         // Two nibbles plus the busy wait
+#define COST_LCD_CLEAR_US 1640
+#define COST_LCD_INIT_US 20000
+#define COST_EEPROM_WRITE_US 4000
+#define TIMER1_PERIOD_US 10000      // set_timer1(63036), 1:8 prescaler
+#define TIMER0_PERIOD_US 32768      // 256 counts, 1:256 prescaler
+#define WDT_PERIOD_US 2304000
+
+struct SimStats sim_stats;
+
+int8 EEDAT, EEADR, EECON1, EECON2;
+int1 EEPGD, WREN, WR;
+
+static uint64_t now_us;
+static uint64_t end_us;
+static jmp_buf end_jump;
+
+static struct SimEvent events[SIM_MAX_EVENTS];
+static int event_count;
+static int next_event;
+
+static int1 pins[SIM_PIN_COUNT];
+static int1 enabled[SIM_INT_COUNT];
+static int1 in_isr;
+static int1 sleeping;
+
+static int1 timer0_on, timer1_on;
+static int1 timer0_flag, timer1_flag;
+static uint64_t timer0_due, timer1_due;
+
+static char rx_fifo[2];
+static int rx_count;
+
+static int1 txreg_full;
+static char txreg;
+static uint64_t tsr_done;           // Shift register busy until then (0 = idle)
+static char tx_log[4096];
+static int tx_log_length;
+
+static unsigned char eeprom[256];
+static int1 eeprom_busy, eeprom_flag;
+static uint64_t eeprom_due;
+static int8 eeprom_address, eeprom_value;
+
+static char ddram[128];
+static int8 lcd_address;
+static uint64_t lcd_us_at_mark;
+static uint64_t last_mark_us;
+
+static void advance(uint64_t us);
+
+int sim_add_event(uint64_t at_us, int kind, int pin, int value)
+{
+    if (event_count == SIM_MAX_EVENTS)
+        return 0;
+    events[event_count].at_us = at_us;
+    events[event_count].kind = kind;
+    events[event_count].pin = pin;
+    events[event_count].value = value;
+    event_count++;
+    return 1;
+}
+
+static int compare_events(const void *a, const void *b)
+{
+    const struct SimEvent *x = a, *y = b;
+    if (x->at_us != y->at_us)
+        return x->at_us < y->at_us ? -1 : 1;
+    return x < y ? -1 : 1; // Keep script order for equal times
+}
+
+uint64_t sim_now_us(void)
+{
+    return now_us;
+}
+
+// Apply everything that is due at now_us
+static void process_due(void)
+{
+    while (next_event < event_count && events[next_event].at_us <= now_us)
+    {
+        struct SimEvent *e = &events[next_event++];
+        if (e->kind == SIM_EVENT_PIN)
+        {
+            pins[e->pin] = e->value;
+        }
+        else
+        {
+            sim_stats.rx_bytes++;
+            if (rx_count < 2)
+                rx_fifo[rx_count++] = (char)e->value;
+            else
+                sim_stats.rx_overruns++;
+        }
+    }
+
+    if (!sleeping)
+    {
+        if (timer1_on && now_us >= timer1_due)
+        {
+            timer1_flag = 1;
+            timer1_due += TIMER1_PERIOD_US;
+        }
+        if (timer0_on && now_us >= timer0_due)
+        {
+            timer0_flag = 1;
+            timer0_due += TIMER0_PERIOD_US;
+        }
+    }
+
+    // Background EEPROM write started through EECON1.WR
+    if (WR && !eeprom_busy)
+    {
+        eeprom_busy = 1;
+        eeprom_address = EEADR;
+        eeprom_value = EEDAT;
+        eeprom_due = now_us + COST_EEPROM_WRITE_US;
+    }
+    if (eeprom_busy && now_us >= eeprom_due)
+    {
+        eeprom[eeprom_address] = eeprom_value;
+        eeprom_busy = 0;
+        WR = 0;
+        eeprom_flag = 1;
+        sim_stats.eeprom_writes++;
+    }
+
+    if (tsr_done && now_us >= tsr_done)
+        tsr_done = 0;
+    if (!tsr_done && txreg_full)
+    {
+        txreg_full = 0;
+        tsr_done = now_us + SIM_UART_BYTE_US;
+        if (tx_log_length < (int)sizeof(tx_log))
+            tx_log[tx_log_length++] = txreg;
+        sim_stats.tx_bytes++;
+    }
+}
+
+// Earliest time after now_us at which something changes, capped at limit
+static uint64_t next_due(uint64_t limit)
+{
+    uint64_t next = limit;
+    if (next_event < event_count && events[next_event].at_us < next)
+        next = events[next_event].at_us;
+    if (!sleeping && timer1_on && timer1_due < next)
+        next = timer1_due;
+    if (!sleeping && timer0_on && timer0_due < next)
+        next = timer0_due;
+    if (eeprom_busy && eeprom_due < next)
+        next = eeprom_due;
+    if (tsr_done && tsr_done < next)
+        next = tsr_done;
+    return next > now_us ? next : now_us;
+}
+
+static void run_isr(void (*handler)(void))
+{
+    uint64_t start = now_us;
+    uint64_t spent;
+
+    in_isr = 1;
+    now_us += COST_ISR_ENTRY_US;
+    handler();
+    in_isr = 0;
+
+    spent = now_us - start;
+    sim_stats.isr_us += spent;
+    sim_stats.isr_calls++;
+    if (spent > sim_stats.worst_isr_us)
+        sim_stats.worst_isr_us = spent;
+}
+
+// Run pending, enabled interrupts (same order as the #INT_ handlers in main.c)
+static void dispatch(void)
+{
+    if (in_isr || !enabled[GLOBAL])
+        return;
+
+    for (;;)
+    {
+        process_due();
+        if (enabled[INT_RDA] && rx_count > 0)
+            run_isr(serial_isr);
+        else if (enabled[INT_TBE] && !txreg_full)
+            run_isr(serial_tx_isr);
+        else if (enabled[INT_EEPROM] && eeprom_flag)
+        {
+            eeprom_flag = 0;
+            run_isr(eeprom_isr);
+        }
+        else if (enabled[INT_TIMER1] && timer1_flag)
+        {
+            timer1_flag = 0;
+            run_isr(timer1_isr);
+        }
+        else if (enabled[INT_TIMER0] && timer0_flag)
+        {
+            timer0_flag = 0;
+            run_isr(timer0_isr);
+        }
+        else
+            return;
+    }
+}
+
+static void check_end(void)
+{
+    if (!in_isr && now_us >= end_us)
+        longjmp(end_jump, 1);
+}
+
+static void advance(uint64_t us)
+{
+    uint64_t target = now_us + us;
+
+    for (;;)
+    {
+        process_due();
+        dispatch();
+        if (now_us >= target)
+            break;
+        now_us = next_due(target);
+    }
+    check_end();
+}
+
+void sim_run(uint64_t end)
+{
+    int i;
+
+    qsort(events, event_count, sizeof(events[0]), compare_events);
+    for (i = 0; i < SIM_PIN_COUNT; i++)
+        pins[i] = 1; // Pull-ups: buttons read high when released
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    memset(ddram, ' ', sizeof(ddram));
+    end_us = end;
+
+    if (setjmp(end_jump) == 0)
+        firmware_main();
+}
+
+// --- Pins, timers, interrupts ---
+
+int1 input(int8 pin)
+{
+    advance(COST_IO_US);
+    return pins[pin];
+}
+
+void output_high(int8 pin)
+{
+    pins[pin] = 1;
+    advance(COST_IO_US);
+}
+
+void output_low(int8 pin)
+{
+    pins[pin] = 0;
+    advance(COST_IO_US);
+}
+
+void output_drive(int8 pin) { (void)pin; advance(COST_IO_US); }
+void set_tris_b(int8 value) { (void)value; advance(COST_IO_US); }
+void port_b_pullups(int1 enable) { (void)enable; advance(COST_IO_US); }
+void setup_oscillator(int8 mode) { (void)mode; advance(COST_IO_US); }
+void setup_wdt(int8 mode) { (void)mode; advance(COST_IO_US); }
+void restart_wdt(void) { advance(COST_IO_US); }
+
+void setup_timer_0(int8 mode)
+{
+    (void)mode;
+    timer0_on = 1;
+    timer0_due = now_us + TIMER0_PERIOD_US;
+    advance(COST_IO_US);
+}
+
+void setup_timer_1(int8 mode)
+{
+    (void)mode;
+    timer1_on = 1;
+    timer1_due = now_us + TIMER1_PERIOD_US;
+    advance(COST_IO_US);
+}
+
+void set_timer1(int16 value) { (void)value; advance(COST_IO_US); }
+
+void enable_interrupts(int8 source)
+{
+    enabled[source] = 1;
+    advance(COST_IO_US);
+}
+
+void disable_interrupts(int8 source)
+{
+    enabled[source] = 0;
+    advance(COST_IO_US);
+}
+
+void delay_ms(int16 ms)
+{
+    advance((uint64_t)ms * 1000);
+}
+
+// Timers stop in sleep; the watchdog or a finished EEPROM write wakes the CPU.
+// Time asleep does not count as main-loop latency.
+void sleep(void)
+{
+    uint64_t wake = now_us + WDT_PERIOD_US;
+    uint64_t start = now_us;
+
+    sim_stats.sleeps++;
+    sleeping = 1;
+    while (now_us < wake && !(eeprom_flag && enabled[INT_EEPROM]))
+    {
+        process_due();
+        now_us = next_due(wake);
+        process_due();
+    }
+    sleeping = 0;
+    last_mark_us += now_us - start;
+    timer1_due = now_us + TIMER1_PERIOD_US;
+    timer0_due = now_us + TIMER0_PERIOD_US;
+    advance(COST_IO_US);
+}
+
+void reset_cpu(void)
+{
+    sim_stats.resets++;
+    longjmp(end_jump, 1);
+}
+
+// --- UART ---
+
+int1 sim_uart_kbhit(void)
+{
+    advance(COST_IO_US);
+    return rx_count > 0;
+}
+
+char sim_uart_getc(void)
+{
+    char c;
+    while (rx_count == 0)
+        advance(COST_IO_US);
+    c = rx_fifo[0];
+    rx_fifo[0] = rx_fifo[1];
+    rx_count--;
+    advance(COST_IO_US);
+    return c;
+}
+
+void sim_uart_putc(char c)
+{
+    while (txreg_full)
+        advance(COST_IO_US);
+    txreg = c;
+    txreg_full = 1;
+    advance(COST_IO_US);
+}
+
+int sim_tx_log(char *out, int size)
+{
+    int start = tx_log_length > size ? tx_log_length - size : 0;
+    memcpy(out, tx_log + start, tx_log_length - start);
+    return tx_log_length - start;
+}
+
+// --- Data EEPROM ---
+
+int8 read_eeprom(int8 address)
+{
+    advance(COST_IO_US);
+    return eeprom[address];
+}
+
+void write_eeprom(int8 address, int8 value)
+{
+    uint64_t start = now_us;
+    while (eeprom_busy)
+        advance(COST_IO_US);
+    eeprom[address] = value;
+    sim_stats.eeprom_writes++;
+    advance(COST_EEPROM_WRITE_US);
+    sim_stats.eeprom_blocked_us += now_us - start;
+}
+
+// --- HD44780 ---
+
+void lcd_send_byte(int8 address, int8 n)
+{
+    if (address == 0)
+    {
+        if (n & 0x80)
+            lcd_address = n & 0x7F;
+    }
+    else
+    {
+        ddram[lcd_address] = (char)n;
+        lcd_address = (lcd_address + 1) & 0x7F;
+    }
+    sim_stats.lcd_bytes++;
+    sim_stats.lcd_us += COST_LCD_BYTE_US;
+    advance(COST_LCD_BYTE_US);
+}
+
+void lcd_putc(char c)
+{
+    if (c == '\f')
+    {
+        memset(ddram, ' ', sizeof(ddram));
+        lcd_address = 0;
+        sim_stats.lcd_bytes++;
+        sim_stats.lcd_us += COST_LCD_CLEAR_US;
+        advance(COST_LCD_CLEAR_US);
+        return;
+    }
+    lcd_send_byte(1, c);
+}
+
+void lcd_init(void)
+{
+    memset(ddram, ' ', sizeof(ddram));
+    lcd_address = 0;
+    advance(COST_LCD_INIT_US);
+}
+
+void sim_lcd_row(int row, char *out20)
+{
+    static const int8 row_address[4] = {0x00, 0x40, 0x14, 0x54};
+    memcpy(out20, ddram + row_address[row], 20);
+}
+
+// --- Formatting ---
+
+// CCS "%lu" is a 16-bit value, promoted to int on the host: drop the 'l'
+static void host_format(char *out, int size, const char *format, va_list args)
+{
+    char fixed[128];
+    int i = 0;
+    int in_spec = 0;
+
+    for (; *format && i < (int)sizeof(fixed) - 1; format++)
+    {
+        if (*format == '%')
+            in_spec = !in_spec;
+        else if (in_spec && (*format == 'l' || *format == 'L'))
+            continue;
+        else if (in_spec && strchr("cdiuxXs", *format))
+            in_spec = 0;
+        fixed[i++] = *format;
+    }
+    fixed[i] = '\0';
+    vsnprintf(out, size, fixed, args);
+}
+
+void sim_printf(void (*out)(char), const char *format, ...)
+{
+    char text[128];
+    char *p;
+    va_list args;
+
+    va_start(args, format);
+    host_format(text, sizeof(text), format, args);
+    va_end(args);
+    for (p = text; *p; p++)
+        out(*p);
+}
+
+int sim_sprintf(char *buffer, const char *format, ...)
+{
+    char text[128];
+    va_list args;
+
+    va_start(args, format);
+    host_format(text, sizeof(text), format, args);
+    va_end(args);
+    strcpy(buffer, text);
+    return (int)strlen(text);
+}
+
+// --- Probes ---
+
+void sim_loop_mark(void)
+{
+    uint64_t gap = now_us - last_mark_us;
+    uint64_t lcd = sim_stats.lcd_us - lcd_us_at_mark;
+
+    if (sim_stats.loop_passes > 0 && gap > sim_stats.worst_loop_us)
+    {
+        sim_stats.worst_loop_us = gap;
+        sim_stats.worst_loop_at_us = last_mark_us;
+    }
+    if (sim_stats.loop_passes > 0 && lcd > sim_stats.worst_lcd_pass_us)
+        sim_stats.worst_lcd_pass_us = lcd;
+    sim_stats.loop_passes++;
+    last_mark_us = now_us;
+    lcd_us_at_mark = sim_stats.lcd_us;
+}
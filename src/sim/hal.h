@@ -0,0 +1,95 @@
+// Mock of the CCS built-ins and PIC16F887 peripherals used by main.c, so
+// the firmware compiles on the host for the simulator. Only main.c includes
+// this header (when __PCM__, the CCS PCM compiler, is not defined).
+#ifndef TELGRAF_SIM_HAL_H
+#define TELGRAF_SIM_HAL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// CCS integer types (all unsigned by default)
+typedef _Bool int1;
+typedef unsigned char int8;
+typedef unsigned short int16;
+typedef unsigned long int32;
+
+#define TRUE 1
+#define FALSE 0
+
+enum
+{
+    PIN_A0, PIN_A1,
+    PIN_B0, PIN_B1, PIN_B2, PIN_B3, PIN_B4,
+    PIN_C6, PIN_C7,
+    PIN_D1, PIN_D2, PIN_D3, PIN_D4, PIN_D5, PIN_D6, PIN_D7,
+    SIM_PIN_COUNT
+};
+
+enum
+{
+    GLOBAL, INT_RDA, INT_TBE, INT_TIMER0, INT_TIMER1, INT_EEPROM,
+    SIM_INT_COUNT
+};
+
+#define OSC_8MHZ 0
+#define WDT_OFF 0
+#define WDT_2304MS 1
+#define T1_INTERNAL 0x85
+#define T1_DIV_BY_8 0x30
+#define T0_INTERNAL 0
+#define T0_DIV_256 7
+#define BT_MODULE 0
+
+// Pins, timers, interrupts
+int1 input(int8 pin);
+void output_high(int8 pin);
+void output_low(int8 pin);
+void output_drive(int8 pin);
+void set_tris_b(int8 value);
+void port_b_pullups(int1 enable);
+void setup_oscillator(int8 mode);
+void setup_wdt(int8 mode);
+void restart_wdt(void);
+void setup_timer_0(int8 mode);
+void setup_timer_1(int8 mode);
+void set_timer1(int16 value);
+void enable_interrupts(int8 source);
+void disable_interrupts(int8 source);
+void delay_ms(int16 ms);
+void sleep(void);
+void reset_cpu(void);
+
+// UART
+int1 sim_uart_kbhit(void);
+char sim_uart_getc(void);
+void sim_uart_putc(char c);
+#define kbhit(stream) sim_uart_kbhit()
+#define fgetc(stream) sim_uart_getc()
+#define fputc(c, stream) sim_uart_putc(c)
+
+// Data EEPROM: the blocking CCS calls and the registers for background writes
+int8 read_eeprom(int8 address);
+void write_eeprom(int8 address, int8 value);
+extern int8 EEDAT, EEADR, EECON1, EECON2;
+extern int1 EEPGD, WREN, WR;
+
+// HD44780 driver (LCD.C)
+void lcd_init(void);
+void lcd_putc(char c);
+void lcd_send_byte(int8 address, int8 n);
+
+// CCS printf(function, format, ...) and its 16-bit "%lu"
+void sim_printf(void (*out)(char), const char *format, ...);
+int sim_sprintf(char *buffer, const char *format, ...);
+#define printf(out, ...) sim_printf(out, __VA_ARGS__)
+#define sprintf(buffer, ...) sim_sprintf(buffer, __VA_ARGS__)
+
+#define make8(value, index) ((int8)((value) >> ((index) * 8)))
+#define bit_test(value, bit) (((value) >> (bit)) & 1)
+#define bit_set(value, bit) ((value) |= (1 << (bit)))
+#define bit_clear(value, bit) ((value) &= ~(1 << (bit)))
+
+void sim_loop_mark(void);
+
+#endif
@@ -0,0 +1,138 @@
+// Generates the morse_table ROM array of main.c from the code list below.
+//   morse_table              print the array
+//   morse_table --check FILE fail if FILE does not contain the same array
+// Index of a code: start at 1, a dot goes to 2n, a dash to 2n+1.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TABLE_SIZE 128 // Codes of up to six elements
+
+struct Code
+{
+    const char *elements;
+    char c;
+};
+
+static const struct Code codes[] = {
+    {".-", 'A'}, {"-...", 'B'}, {"-.-.", 'C'}, {"-..", 'D'}, {".", 'E'},
+    {"..-.", 'F'}, {"--.", 'G'}, {"....", 'H'}, {"..", 'I'}, {".---", 'J'},
+    {"-.-", 'K'}, {".-..", 'L'}, {"--", 'M'}, {"-.", 'N'}, {"---", 'O'},
+    {".--.", 'P'}, {"--.-", 'Q'}, {".-.", 'R'}, {"...", 'S'}, {"-", 'T'},
+    {"..-", 'U'}, {"...-", 'V'}, {".--", 'W'}, {"-..-", 'X'}, {"-.--", 'Y'},
+    {"--..", 'Z'},
+    {"-----", '0'}, {".----", '1'}, {"..---", '2'}, {"...--", '3'}, {"....-", '4'},
+    {".....", '5'}, {"-....", '6'}, {"--...", '7'}, {"---..", '8'}, {"----.", '9'},
+    {".-.-.-", '.'}, {"--..--", ','}, {"..--..", '?'}, {".----.", '\''},
+    {"-.-.--", '!'}, {"-..-.", '/'}, {"-.--.", '('}, {"-.--.-", ')'},
+    {".-...", '&'}, {"---...", ':'}, {"-.-.-.", ';'}, {"-...-", '='},
+    {".-.-.", '+'}, {"-....-", '-'}, {"..--.-", '_'}, {".-..-.", '"'},
+    {".--.-.", '@'},
+    {"...-.-", '#'}, // Prosign SK (end of contact); AR and BT are '+' and '='
+};
+
+static int build(char table[TABLE_SIZE])
+{
+    size_t i;
+    memset(table, 0, TABLE_SIZE);
+    for (i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+    {
+        const char *p;
+        int index = 1;
+        for (p = codes[i].elements; *p; p++)
+            index = index * 2 + (*p == '-');
+        if (index >= TABLE_SIZE || table[index])
+        {
+            fprintf(stderr, "ERROR: code %s does not fit or is duplicated\n", codes[i].elements);
+            return 0;
+        }
+        table[index] = codes[i].c;
+    }
+    return 1;
+}
+
+// The array as it appears in main.c (without line endings)
+static void render(const char table[TABLE_SIZE], char *out, size_t size)
+{
+    int i;
+    size_t used = 0;
+
+    used += snprintf(out + used, size - used, "const char morse_table[%d] = {\n", TABLE_SIZE);
+    for (i = 0; i < TABLE_SIZE; i++)
+    {
+        char entry[8];
+        if (table[i] == 0)
+            strcpy(entry, "0");
+        else if (table[i] == '\'')
+            strcpy(entry, "'\\''");
+        else
+            snprintf(entry, sizeof(entry), "'%c'", table[i]);
+
+        if (i % 16 == 0)
+            used += snprintf(out + used, size - used, "    ");
+        used += snprintf(out + used, size - used, "%s%s", entry,
+                         i == TABLE_SIZE - 1 ? "};\n" : (i % 16 == 15 ? ",\n" : ", "));
+    }
+}
+
+// Reads a file, dropping carriage returns
+static char *read_text(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    char *text;
+    long length;
+    long i, j;
+
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text = malloc(length + 1);
+    if (!text || fread(text, 1, length, file) != (size_t)length)
+    {
+        fclose(file);
+        free(text);
+        return NULL;
+    }
+    fclose(file);
+    for (i = 0, j = 0; i < length; i++)
+    {
+        if (text[i] != '\r')
+            text[j++] = text[i];
+    }
+    text[j] = '\0';
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    char table[TABLE_SIZE];
+    char rendered[4096];
+
+    if (!build(table))
+        return 1;
+    render(table, rendered, sizeof(rendered));
+
+    if (argc == 3 && strcmp(argv[1], "--check") == 0)
+    {
+        char *source = read_text(argv[2]);
+        int found;
+        if (!source)
+        {
+            fprintf(stderr, "ERROR: cannot read %s\n", argv[2]);
+            return 1;
+        }
+        found = strstr(source, rendered) != NULL;
+        free(source);
+        if (!found)
+        {
+            fprintf(stderr, "ERROR: morse_table in %s is out of date, regenerate it with morse_table\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+
+    fputs(rendered, stdout);
+    return 0;
+}
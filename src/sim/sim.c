@@ -0,0 +1,243 @@
+// Scenario runner: replays a script of button presses and received frames
+// against the host-compiled firmware and prints latency, interrupt and drop
+// figures.
+//
+// Script lines (times in milliseconds from power-on, '#' starts a comment):
+//   <ms> press <SIGNAL|UPLOAD|DELETE|RESET|MODE> <hold_ms>
+//   <ms> key <dots and dashes> [dot_ms]
+//                                    Signal presses: by default 100 ms dots,
+//                                    450 ms dashes and 150 ms gaps; with
+//                                    dot_ms, 1:3 dots and dashes, 1-dot gaps
+//   <ms> frame <T,payload>           NMEA frame, checksum added
+//   <ms> corrupt <T,payload>         The same with a wrong checksum
+//   <ms> burst <count> <T,payload>   The same frame back to back
+//   <ms> end                         Stop the simulation
+// Received bytes never overlap: a frame starts when the line is free.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+// PORTB pins of the buttons, in the order of the hal.h pin enum
+enum { SIM_PIN_B0 = 2 };
+
+// Receive counters kept by the firmware (int16 in main.c)
+extern unsigned short rx_overflow_count;
+extern unsigned short rx_oversize_count;
+extern unsigned short rx_error_count;
+
+static uint64_t line_free_us;       // End of the last scheduled received byte
+static uint64_t frames_sent;
+
+static int button_pin(const char *name)
+{
+    static const char *names[] = {"SIGNAL", "UPLOAD", "DELETE", "RESET", "MODE"};
+    int i;
+    for (i = 0; i < 5; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+            return SIM_PIN_B0 + i;
+    }
+    return -1;
+}
+
+static void press(uint64_t at_us, int pin, uint64_t hold_us)
+{
+    sim_add_event(at_us, SIM_EVENT_PIN, pin, 0);
+    sim_add_event(at_us + hold_us, SIM_EVENT_PIN, pin, 1);
+}
+
+static void send_bytes(uint64_t at_us, const char *bytes, int length)
+{
+    int i;
+    if (at_us < line_free_us)
+        at_us = line_free_us;
+    for (i = 0; i < length; i++)
+    {
+        at_us += SIM_UART_BYTE_US;
+        sim_add_event(at_us, SIM_EVENT_RX, 0, (unsigned char)bytes[i]);
+    }
+    line_free_us = at_us;
+}
+
+static void send_frame(uint64_t at_us, const char *body, int damaged)
+{
+    char frame[96];
+    unsigned char checksum = 0;
+    const char *p;
+
+    for (p = body; *p; p++)
+        checksum ^= (unsigned char)*p;
+    if (damaged)
+        checksum ^= 0x01;
+    snprintf(frame, sizeof(frame), "$%s*%02X\r\n", body, checksum);
+    send_bytes(at_us, frame, (int)strlen(frame));
+    frames_sent++;
+}
+
+static int load_script(const char *path, uint64_t *end_us)
+{
+    char line[160];
+    char command[16], arg1[96], arg2[96];
+    double ms;
+    int line_number = 0;
+    FILE *file = fopen(path, "r");
+
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: cannot open %s\n", path);
+        return 0;
+    }
+
+    *end_us = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        uint64_t at_us;
+        int fields;
+
+        line_number++;
+        if (comment)
+            *comment = '\0';
+        fields = sscanf(line, "%lf %15s %95s %95s", &ms, command, arg1, arg2);
+        if (fields <= 0)
+            continue;
+        at_us = (uint64_t)(ms * 1000.0);
+
+        if (fields >= 2 && strcmp(command, "end") == 0)
+        {
+            *end_us = at_us;
+        }
+        else if (fields == 4 && strcmp(command, "press") == 0 && button_pin(arg1) >= 0)
+        {
+            press(at_us, button_pin(arg1), (uint64_t)(atof(arg2) * 1000.0));
+        }
+        else if (fields >= 3 && strcmp(command, "key") == 0)
+        {
+            uint64_t dot_us = fields == 4 ? (uint64_t)(atof(arg2) * 1000.0) : 0;
+            const char *p;
+            for (p = arg1; *p; p++)
+            {
+                uint64_t hold_us = *p == '-' ? 450000 : 100000;
+                uint64_t gap_us = 150000;
+                if (dot_us)
+                {
+                    hold_us = *p == '-' ? 3 * dot_us : dot_us;
+                    gap_us = dot_us;
+                }
+                press(at_us, button_pin("SIGNAL"), hold_us);
+                at_us += hold_us + gap_us;
+            }
+        }
+        else if (fields == 3 && (strcmp(command, "frame") == 0 || strcmp(command, "corrupt") == 0))
+        {
+            send_frame(at_us, arg1, command[0] == 'c');
+        }
+        else if (fields == 4 && strcmp(command, "burst") == 0)
+        {
+            int count = atoi(arg1);
+            while (count-- > 0)
+                send_frame(at_us, arg2, 0);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: %s:%d: cannot parse \"%s\"\n", path, line_number, command);
+            fclose(file);
+            return 0;
+        }
+    }
+    fclose(file);
+
+    if (*end_us == 0)
+    {
+        fprintf(stderr, "ERROR: %s has no \"end\" line\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+static const char *scenario_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void report(const char *path, int verbose)
+{
+    uint64_t total_us = sim_now_us();
+    int row;
+
+    printf("%s (%.1f s simulated)\n", scenario_name(path), total_us / 1e6);
+    printf("  main loop passes       : %llu\n", (unsigned long long)sim_stats.loop_passes);
+    printf("  worst main-loop latency: %.2f ms (at %.3f s)\n",
+           sim_stats.worst_loop_us / 1e3, sim_stats.worst_loop_at_us / 1e6);
+    printf("  ISR occupancy          : %.2f %% (%llu calls, worst %.0f us)\n",
+           total_us ? 100.0 * sim_stats.isr_us / total_us : 0.0,
+           (unsigned long long)sim_stats.isr_calls, (double)sim_stats.worst_isr_us);
+    printf("  frames sent to the PIC : %llu\n", (unsigned long long)frames_sent);
+    printf("  frames dropped         : %u queue full, %u too long, %u bad; %llu UART overrun bytes\n",
+           rx_overflow_count, rx_oversize_count, rx_error_count,
+           (unsigned long long)sim_stats.rx_overruns);
+    printf("  LCD bus                : %llu bytes, %.2f ms total, worst %.2f ms in one pass\n",
+           (unsigned long long)sim_stats.lcd_bytes, sim_stats.lcd_us / 1e3,
+           sim_stats.worst_lcd_pass_us / 1e3);
+    printf("  EEPROM                 : %llu writes, %.1f ms blocked\n",
+           (unsigned long long)sim_stats.eeprom_writes, sim_stats.eeprom_blocked_us / 1e3);
+    printf("  UART TX                : %llu bytes\n", (unsigned long long)sim_stats.tx_bytes);
+    if (sim_stats.sleeps || sim_stats.resets)
+        printf("  sleep / reset          : %llu / %d\n", (unsigned long long)sim_stats.sleeps, sim_stats.resets);
+
+    if (verbose)
+    {
+        char text[21];
+        char tx[256];
+        int length, i;
+
+        for (row = 0; row < 4; row++)
+        {
+            sim_lcd_row(row, text);
+            text[20] = '\0';
+            printf("  LCD %d |%s|\n", row + 1, text);
+        }
+        length = sim_tx_log(tx, sizeof(tx));
+        printf("  TX tail: ");
+        for (i = 0; i < length; i++)
+        {
+            if (tx[i] == '\r')
+                printf("\\r");
+            else if (tx[i] == '\n')
+                printf("\\n");
+            else if ((unsigned char)tx[i] < 0x20 || (unsigned char)tx[i] > 0x7E)
+                printf("\\x%02X", (unsigned char)tx[i]);
+            else
+                putchar(tx[i]);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t end_us;
+    int verbose = 0;
+    int arg = 1;
+
+    if (arg < argc && strcmp(argv[arg], "-v") == 0)
+    {
+        verbose = 1;
+        arg++;
+    }
+    if (arg != argc - 1)
+    {
+        fprintf(stderr, "usage: telgraf_sim [-v] <scenario.txt>\n");
+        return 2;
+    }
+
+    if (!load_script(argv[arg], &end_us))
+        return 1;
+
+    sim_run(end_us);
+    report(argv[arg], verbose);
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Simulator engine shared by the mock HAL (hal.c) and the scenario runner
+// (sim.c). Time is simulated in microseconds and only advances through HAL
+// calls, each charged with what it costs on the PIC at 8 MHz; plain C code
+// between them is treated as free.
+#ifndef TELGRAF_SIM_SIM_H
+#define TELGRAF_SIM_SIM_H
+
+#include <stdint.h>
+
+#define SIM_UART_BYTE_US 1042       // 10 bits at 9600 baud
+#define SIM_MAX_EVENTS 4096
+
+enum SimEventKind
+{
+    SIM_EVENT_PIN,                  // Drive an input pin (buttons are active low)
+    SIM_EVENT_RX                    // A byte reaches the UART receiver
+};
+
+struct SimEvent
+{
+    uint64_t at_us;
+    int kind;
+    int pin;
+    int value;
+};
+
+struct SimStats
+{
+    uint64_t loop_passes;
+    uint64_t worst_loop_us;         // Longest time between two main-loop passes
+    uint64_t worst_loop_at_us;
+    uint64_t isr_us;                // Time spent in interrupt handlers
+    uint64_t worst_isr_us;
+    uint64_t isr_calls;
+    uint64_t rx_bytes;
+    uint64_t rx_overruns;           // Bytes lost because the 2-byte UART FIFO was full
+    uint64_t tx_bytes;
+    uint64_t lcd_bytes;
+    uint64_t lcd_us;
+    uint64_t worst_lcd_pass_us;     // Most LCD bus time within one main-loop pass
+    uint64_t eeprom_writes;
+    uint64_t eeprom_blocked_us;     // Time spent waiting in write_eeprom
+    uint64_t sleeps;
+    int resets;
+};
+
+extern struct SimStats sim_stats;
+
+// Adds an event; events may be added in any order before sim_run
+int sim_add_event(uint64_t at_us, int kind, int pin, int value);
+
+// Runs the firmware until end_us (or until it resets the CPU)
+void sim_run(uint64_t end_us);
+
+uint64_t sim_now_us(void);
+
+// Current LCD contents, row by row as the panel shows them
+void sim_lcd_row(int row, char *out20);
+
+// Bytes the firmware sent over the UART (up to the last `size`)
+int sim_tx_log(char *out, int size);
+
+#endif
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDate>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Background writer for telegraph.log.
+// Any thread can queue a line through a bounded lock-free MPSC ring; a single
+// writer thread drains it and appends whole batches to the file, flushing when
+// either the size threshold or the flush interval is reached. The file is rotated
+// (telegraph.log -> telegraph.log.1 -> ...) on size and when the date changes.
+class AsyncLogger {
+public:
+    struct Options {
+        QString path = "telegraph.log";
+        int flushIntervalMs = 500;      // Upper bound for a line to sit in memory
+        int flushBytes = 16 * 1024;     // Write as soon as this much is pending
+        qint64 maxFileBytes = 4 * 1024 * 1024; // Rotate when the file would exceed this
+        bool rotateDaily = true;        // Rotate when the local date changes
+        int keepFiles = 5;              // Rotated files kept next to the active one
+    };
+
+    explicit AsyncLogger(const Options &options, int capacity = 4096)
+        : opts(options) {
+        int size = 1;
+        while (size < capacity) size <<= 1;
+        mask = size_t(size) - 1;
+        ring.reset(new Slot[size]);
+        for (int i = 0; i < size; i++) {
+            ring[i].sequence.store(size_t(i), std::memory_order_relaxed);
+        }
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~AsyncLogger() {
+        stop();
+    }
+
+    // Queues one line (without trailing newline). Never blocks; returns false and
+    // counts the line as dropped if the ring is full.
+    bool log(QByteArray line) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &ring[pos & mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                wake.notify_one();
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        const size_t bytes = size_t(line.size()) + 1;
+        slot->data = std::move(line);
+        const size_t pending = pendingBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        if (pending >= size_t(opts.flushBytes)) {
+            wake.notify_one();
+        }
+        return true;
+    }
+
+    // Drains everything queued so far, writes it out and joins the writer thread
+    void stop() {
+        if (!writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    quint64 droppedLines() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        QByteArray data;
+    };
+
+    // Moves every ready slot into the pending batch; returns false if the ring was empty
+    bool drain() {
+        bool any = false;
+        for (;;) {
+            Slot &slot = ring[dequeuePos & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+
+            batch.append(slot.data);
+            batch.append('\n');
+            batchLines++;
+            pendingBytes.fetch_sub(size_t(slot.data.size()) + 1, std::memory_order_relaxed);
+            slot.data = QByteArray();
+            slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+            dequeuePos++;
+            any = true;
+        }
+        return any;
+    }
+
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::milliseconds(opts.flushIntervalMs);
+        auto lastFlush = Clock::now();
+
+        for (;;) {
+            bool quit;
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wake.wait_for(lock, interval, [this]() {
+                    return stopping || pendingBytes.load(std::memory_order_relaxed) >= size_t(opts.flushBytes);
+                });
+                quit = stopping;
+            }
+
+            drain();
+
+            quint64 lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                batch.append("--- LOGGER: " + QByteArray::number(lost) + " lines dropped (queue full or file not writable) ---\n");
+                batchLines += lost;
+            }
+
+            if (!batch.isEmpty() && (quit || batch.size() >= opts.flushBytes || Clock::now() - lastFlush >= interval)) {
+                writeBatch();
+                lastFlush = Clock::now();
+            }
+
+            if (quit) {
+                // Producers may still have raced in a few lines before the flag was seen
+                if (drain()) writeBatch();
+                if (file.isOpen()) file.close();
+                return;
+            }
+        }
+    }
+
+    void writeBatch() {
+        QDate today = QDate::currentDate();
+        if (file.isOpen()) {
+            bool dateChanged = opts.rotateDaily && today != fileDate;
+            bool tooLarge = opts.maxFileBytes > 0 && file.size() + batch.size() > opts.maxFileBytes;
+            if (dateChanged || tooLarge) rotate();
+        }
+
+        if (!file.isOpen()) {
+            QFileInfo info(opts.path);
+            fileDate = info.exists() ? info.lastModified().date() : today;
+            file.setFileName(opts.path);
+            if (!file.open(QIODevice::Append | QIODevice::Text)) {
+                dropBatch();
+                return;
+            }
+            if (opts.rotateDaily && fileDate != today && file.size() > 0) {
+                rotate();
+                if (!file.open(QIODevice::Append | QIODevice::Text)) {
+                    dropBatch();
+                    return;
+                }
+            }
+            fileDate = today;
+        }
+
+        file.write(batch);
+        file.flush();
+        batch.clear();
+        batchLines = 0;
+    }
+
+    // The file could not be opened: count the batch as dropped so the next
+    // marker that makes it to disk reports it
+    void dropBatch() {
+        dropped.fetch_add(batchLines, std::memory_order_relaxed);
+        batch.clear();
+        batchLines = 0;
+    }
+
+    // Shifts telegraph.log.N -> .N+1 and moves the active file to .1
+    void rotate() {
+        file.close();
+        QFile::remove(opts.path + "." + QString::number(opts.keepFiles));
+        for (int i = opts.keepFiles - 1; i >= 1; i--) {
+            QFile::rename(opts.path + "." + QString::number(i), opts.path + "." + QString::number(i + 1));
+        }
+        if (opts.keepFiles > 0) QFile::rename(opts.path, opts.path + ".1");
+        else QFile::remove(opts.path);
+        file.setFileName(opts.path);
+    }
+
+    Options opts;
+
+    std::unique_ptr<Slot[]> ring;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos = 0;
+    std::atomic<size_t> pendingBytes{0};
+    std::atomic<quint64> dropped{0};
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // Writer thread only
+    QByteArray batch;
+    quint64 batchLines = 0;     // Lines the batch stands for, those behind a marker included
+    QFile file;
+    QDate fileDate;
+    std::thread writer;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QtGlobal>
+
+// Compact binary framing, negotiated with the PIC as an alternative to "$T,...*CS".
+// On the wire a frame is 0x00, COBS(type, length, payload..., crc_hi, crc_lo), 0x00.
+// COBS removes every zero byte from the frame, so 0x00 only ever marks frame
+// boundaries; the CRC is CRC-16/CCITT-FALSE over type, length and payload.
+// A decoded frame is kept to MaxFrame bytes so the first COBS code byte stays
+// below '$' (the receivers tell text and binary frames apart by that byte) and
+// the payload fits the PIC's receive slot: a 24-character message behind the
+// reliable delivery header "NN,M,".
+namespace BinaryFraming {
+
+constexpr int Overhead = 4;                         // type, length, 2 CRC bytes
+constexpr int MaxFrame = 33;                        // Decoded bytes, first code byte <= 34 < '$'
+constexpr int MaxPayload = MaxFrame - Overhead;
+constexpr int MaxEncoded = MaxFrame + 1;            // COBS adds one byte per 254
+
+inline quint16 crc16(const char *data, int length, quint16 crc = 0xFFFF) {
+    for (int i = 0; i < length; i++) {
+        crc ^= quint16(quint8(data[i])) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Builds the delimited wire form of a frame. Payloads longer than MaxPayload
+// do not fit and yield an empty array; send those as text instead.
+inline QByteArray encode(char type, QByteArrayView payload) {
+    if (payload.size() > MaxPayload) return QByteArray();
+
+    char frame[MaxFrame];
+    int length = 0;
+    frame[length++] = type;
+    frame[length++] = char(payload.size());
+    for (char c : payload) frame[length++] = c;
+    quint16 crc = crc16(frame, length);
+    frame[length++] = char(crc >> 8);
+    frame[length++] = char(crc & 0xFF);
+
+    QByteArray out;
+    out.reserve(length + 3);
+    out.append('\0');
+    int codeAt = int(out.size());
+    out.append('\x01');
+    for (int i = 0; i < length; i++) {
+        if (frame[i] == 0) {
+            codeAt = int(out.size());
+            out.append('\x01');
+        } else {
+            out.append(frame[i]);
+            out[codeAt] = char(out[codeAt] + 1);
+        }
+    }
+    out.append('\0');
+    return out;
+}
+
+// Decodes one COBS block (without delimiters) in place. Returns the decoded
+// length, or -1 if the block is not valid COBS.
+inline int decodeInPlace(char *data, int length) {
+    int read = 0;
+    int write = 0;
+    while (read < length) {
+        int code = quint8(data[read++]);
+        if (code == 0 || read + code - 1 > length) return -1;
+        for (int i = 1; i < code; i++) data[write++] = data[read++];
+        if (code < 0xFF && read < length) data[write++] = 0;
+    }
+    return write;
+}
+
+} // namespace BinaryFraming
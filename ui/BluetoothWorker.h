@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QtBluetooth/QBluetoothSocket>
+#include <QtBluetooth/QBluetoothAddress>
+#include <QtBluetooth/QBluetoothUuid>
+
+#include "LinkWorker.h"
+
+// Worker class to handle the Bluetooth RFCOMM socket in a separate thread
+class BluetoothWorker : public LinkWorker {
+    Q_OBJECT
+public:
+    BluetoothWorker() = default;
+    ~BluetoothWorker() {
+        if (socket) socket->abort();
+        delete socket;
+    }
+
+public slots:
+    // Connects to the serial port service of the given device.
+    // The socket is created here so it belongs to the worker thread.
+    void openSocket(QString address) {
+        if (!socket) {
+            socket = new QBluetoothSocket(QBluetoothServiceInfo::RfcommProtocol);
+            connect(socket, &QBluetoothSocket::connected, this, [this]() {
+                parser.reset();
+                linkDownReported = false;
+                emit connectionStatusChanged(true, peerAddress);
+            });
+            connect(socket, &QBluetoothSocket::disconnected, this, &BluetoothWorker::reportLinkDown);
+            connect(socket, &QBluetoothSocket::errorOccurred, this, [this](QBluetoothSocket::SocketError) {
+                emit errorOccurred("BLUETOOTH ERROR: " + socket->errorString());
+                if (socket->state() != QBluetoothSocket::SocketState::ConnectedState) {
+                    reportLinkDown();
+                }
+            });
+            connect(socket, &QBluetoothSocket::readyRead, this, &BluetoothWorker::readData);
+        }
+
+        peerAddress = address;
+        linkDownReported = false;
+        socket->connectToService(QBluetoothAddress(address), QBluetoothUuid::ServiceClassUuid::SerialPort);
+    }
+
+    // Disconnects from the remote device
+    void closeSocket() {
+        if (socket && socket->state() != QBluetoothSocket::SocketState::UnconnectedState) {
+            socket->disconnectFromService();
+        } else {
+            emit connectionStatusChanged(false, "");
+        }
+    }
+
+    // Feeds whatever bytes are available into the frame parser
+    void readData() {
+        readAvailable();
+    }
+
+protected:
+    QIODevice *device() const override { return socket; }
+
+private:
+    // A dropped connection usually raises both errorOccurred and disconnected;
+    // report it once so the ConnectionManager schedules a single reconnect
+    void reportLinkDown() {
+        if (linkDownReported) return;
+        linkDownReported = true;
+        emit connectionStatusChanged(false, "");
+    }
+
+    QBluetoothSocket *socket = nullptr;
+    QString peerAddress;
+    bool linkDownReported = false;  // Link-down already sent for this attempt
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+#include "CommandTable.h"
+#include "LinkMetrics.h"
+#include "SpawnHelper.h"
+
+// Runs configured commands and reports how they ended.
+// On Unix the commands are handed to the warm SpawnHelper, which reports the
+// exit status and run time of every child. Without the helper (disabled,
+// failed, or on Windows) each command runs in a QProcess owned by the
+// executor instead, so it is tracked the same way; commands of that kind
+// still running when the station exits are ended with it. Either way at most
+// `maxConcurrent` commands may be running at once, further ones are rejected,
+// so a flood of `$K` frames cannot exhaust the host.
+class CommandExecutor : public QObject {
+    Q_OBJECT
+public:
+    CommandExecutor(int maxConcurrent, bool useHelper, QObject *parent = nullptr)
+        : QObject(parent), maxRunning(qMax(1, maxConcurrent)) {
+#ifdef Q_OS_UNIX
+        if (useHelper && SpawnHelper::isAvailable()) {
+            helper = new SpawnHelper(this);
+            connect(helper, &SpawnHelper::resultReady, this, &CommandExecutor::handleHelperResult);
+        }
+#else
+        Q_UNUSED(useHelper);
+#endif
+    }
+
+    // Starts a command. Returns false if it was rejected because too many
+    // commands are still running. `dispatchedNs` (monotonicNs) is the moment
+    // the command was dispatched; commandStarted reports the time since.
+    bool execute(const CommandSpec &cmd, qint64 dispatchedNs) {
+        if (dryRun) {
+            emit commandStarted(QString::fromUtf8(cmd.key), 0, monotonicNs() - dispatchedNs);
+            return true;
+        }
+        if (running.size() >= maxRunning) return false;
+
+        quint32 id = nextId++;
+        running.insert(id, {QString::fromUtf8(cmd.key), dispatchedNs, 0});
+#ifdef Q_OS_UNIX
+        if (helper && SpawnHelper::isAvailable() && helper->spawn(id, cmd.program, cmd.arguments)) return true;
+#endif
+        startProcess(id, cmd);
+        return true;
+    }
+
+    // Commands are reported as started without running anything (telgraf_replay)
+    void setDryRun(bool on) { dryRun = on; }
+
+    int runningCount() const { return int(running.size()); }
+    int maxConcurrent() const { return maxRunning; }
+
+    // Short description of the active engine for the log
+    QString engineName() const {
+#ifdef Q_OS_UNIX
+        if (helper && SpawnHelper::isAvailable()) return "spawn helper";
+#endif
+        return "QProcess";
+    }
+
+signals:
+    // `latencyNs`: from dispatch until the process was running
+    void commandStarted(QString key, qint64 pid, qint64 latencyNs);
+    void commandFinished(QString key, int exitCode, bool crashed, qint64 durationMs);
+    void commandFailed(QString key, QString error);
+
+private:
+    // Fallback without the helper: the QProcess reports start, exit and failure
+    void startProcess(quint32 id, const CommandSpec &cmd) {
+        QProcess *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->setStandardInputFile(QProcess::nullDevice());
+
+        connect(process, &QProcess::started, this, [this, id, process]() {
+            auto it = running.find(id);
+            if (it == running.end()) return;
+            it.value().startedNs = monotonicNs();
+            emit commandStarted(it.value().key, process->processId(), it.value().startedNs - it.value().dispatchedNs);
+        });
+        connect(process, &QProcess::finished, this, [this, id, process](int exitCode, QProcess::ExitStatus status) {
+            Running done = running.take(id);
+            emit commandFinished(done.key, exitCode, status == QProcess::CrashExit,
+                                 (monotonicNs() - done.startedNs) / 1000000);
+            process->deleteLater();
+        });
+        connect(process, &QProcess::errorOccurred, this, [this, id, process](QProcess::ProcessError error) {
+            if (error != QProcess::FailedToStart) return; // Crashes also arrive through finished
+            Running failed = running.take(id);
+            emit commandFailed(failed.key, process->errorString());
+            process->deleteLater();
+        });
+        process->start(cmd.program, cmd.arguments);
+    }
+
+#ifdef Q_OS_UNIX
+    void handleHelperResult(SpawnHelper::Result result) {
+        auto it = running.find(result.id);
+        if (it == running.end()) return;
+        const QString key = it.value().key;
+
+        switch (result.kind) {
+        case SpawnHelper::Started:
+            emit commandStarted(key, result.pid, monotonicNs() - it.value().dispatchedNs);
+            return;
+        case SpawnHelper::Failed:
+            running.erase(it);
+            emit commandFailed(key, QString::fromLocal8Bit(strerror(result.status)));
+            return;
+        case SpawnHelper::Lost:
+            running.erase(it);
+            emit commandFailed(key, "spawn helper exited, the command is no longer tracked");
+            return;
+        case SpawnHelper::Exited:
+            running.erase(it);
+            if (WIFEXITED(result.status)) {
+                emit commandFinished(key, WEXITSTATUS(result.status), false, result.durationNs / 1000000);
+            } else {
+                emit commandFinished(key, WIFSIGNALED(result.status) ? WTERMSIG(result.status) : -1, true,
+                                     result.durationNs / 1000000);
+            }
+            return;
+        }
+    }
+
+    SpawnHelper *helper = nullptr;
+#endif
+
+    struct Running {
+        QString key;
+        qint64 dispatchedNs;
+        qint64 startedNs;   // QProcess fallback only, for the run time
+    };
+
+    QHash<quint32, Running> running;
+    quint32 nextId = 1;
+    int maxRunning;
+    bool dryRun = false;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+
+#include "CommandTable.h"
+
+using CommandTablePtr = std::shared_ptr<CommandTable>;
+
+// Watches Command.json and rebuilds the dispatch table when it changes.
+// Parsing and compiling run on a private pool thread; the finished table is
+// delivered through tableLoaded on the owner's thread, where it can be swapped
+// in while commands already started keep running.
+class CommandReloader : public QObject {
+    Q_OBJECT
+public:
+    explicit CommandReloader(const QString &path, QObject *parent = nullptr)
+        : QObject(parent), configPath(path) {
+        pool.setMaxThreadCount(1);
+
+        // Editors often save several times in a row or replace the file
+        debounce.setSingleShot(true);
+        debounce.setInterval(200);
+        connect(&debounce, &QTimer::timeout, this, &CommandReloader::reloadNow);
+
+        connect(&watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+            rewatch();
+            debounce.start();
+        });
+        connect(&watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+            if (!watcher.files().contains(configPath) && QFileInfo::exists(configPath)) {
+                rewatch();
+                debounce.start();
+            }
+        });
+
+        watcher.addPath(QFileInfo(configPath).absolutePath());
+        rewatch();
+    }
+
+    ~CommandReloader() {
+        pool.waitForDone();
+    }
+
+    // Reads and compiles a command file; returns nullptr and sets `error` on failure
+    static CommandTablePtr load(const QString &path, QString *error) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            if (error) *error = "Config file not found at " + path;
+            return nullptr;
+        }
+
+        CommandTablePtr table = std::make_shared<CommandTable>();
+        QString parseError;
+        if (!table->loadJson(file.readAll(), &parseError)) {
+            if (error) *error = "Config JSON is invalid (" + parseError + ").";
+            return nullptr;
+        }
+        return table;
+    }
+
+signals:
+    void tableLoaded(CommandTablePtr table);
+    void reloadFailed(QString error);
+
+private:
+    void rewatch() {
+        if (QFileInfo::exists(configPath) && !watcher.files().contains(configPath)) {
+            watcher.addPath(configPath);
+        }
+    }
+
+    void reloadNow() {
+        const QString path = configPath;
+        pool.start([this, path]() {
+            QString error;
+            CommandTablePtr table = load(path, &error);
+            if (table) emit tableLoaded(table);
+            else emit reloadFailed(error);
+        });
+    }
+
+    QString configPath;
+    QFileSystemWatcher watcher;
+    QTimer debounce;
+    QThreadPool pool;
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A configured system command, compiled once when Command.json is loaded
+struct CommandSpec {
+    QByteArray key;         // Upper-cased trigger as sent by the PIC ("BR")
+    QString systemCommand;  // The command line exactly as configured
+    QString program;        // Executable started for this command
+    QStringList arguments;  // Pre-split argument vector for `program`
+    bool useShell = true;   // false: run directly from argv, no /bin/sh in between
+};
+
+// Flat dispatch table for `$K` commands.
+// Keys live in an open-addressing hash table (FNV-1a, linear probing) that is
+// probed straight with the raw payload bytes: trimming and upper-casing happen
+// while hashing/comparing, so a lookup never allocates. Cooldown state is kept
+// in two parallel arrays indexed by command, separate from the cold specs.
+class CommandTable {
+public:
+    // Compiles a Command.json document. Returns false and sets `error` if the
+    // document is not a JSON object or an entry has no command; the table is
+    // left untouched in that case.
+    bool loadJson(const QByteArray &json, QString *error = nullptr) {
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+        if (doc.isNull() || !doc.isObject()) {
+            if (error) *error = doc.isNull() ? parseError.errorString() : QString("root is not an object");
+            return false;
+        }
+
+        const QJsonObject root = doc.object();
+        for (auto it = root.begin(); it != root.end(); ++it) {
+            QJsonObject cmdObj = it.value().toObject();
+            if (cmdObj["cmd"].toString().trimmed().isEmpty()) {
+                if (error) *error = "entry '" + it.key() + "' has no cmd";
+                return false;
+            }
+            if (cmdObj["timeout"].toInt(2000) < 0) {
+                if (error) *error = "entry '" + it.key() + "' has a negative timeout";
+                return false;
+            }
+        }
+
+        clear();
+        for (auto it = root.begin(); it != root.end(); ++it) {
+            QJsonObject cmdObj = it.value().toObject();
+            insert(it.key(), cmdObj["cmd"].toString(), cmdObj["timeout"].toInt(2000),
+                   cmdObj["shell"].toBool(true));
+        }
+        return true;
+    }
+
+    // Copies the cooldown timestamps of commands that did not change from the
+    // table this one replaces, so a reload does not re-arm them.
+    void inheritCooldowns(const CommandTable &previous) {
+        for (int i = 0; i < specs.size(); i++) {
+            int j = previous.find(specs[i].key);
+            if (j < 0) continue;
+            const CommandSpec &old = previous.specs[j];
+            if (old.systemCommand == specs[i].systemCommand && old.useShell == specs[i].useShell &&
+                previous.offsetMs[j] == offsetMs[i]) {
+                lastRunMs[i] = previous.lastRunMs[j];
+            }
+        }
+    }
+
+    void clear() {
+        specs.clear();
+        lastRunMs.clear();
+        offsetMs.clear();
+        buckets.clear();
+        bucketHashes.clear();
+        mask = 0;
+    }
+
+    // Adds (or replaces) a command and rebuilds the hash index if needed.
+    // Commands marked `"shell": false` are split once here and later started
+    // without a shell; they must not rely on pipes, globs or variables.
+    void insert(const QString &key, const QString &systemCommand, int cooldownMs, bool shell = true) {
+        CommandSpec spec;
+        spec.key = normalizedKey(key);
+        spec.systemCommand = systemCommand;
+
+        QStringList argv = shell ? QStringList() : QProcess::splitCommand(systemCommand);
+        if (argv.isEmpty()) {
+            spec.program = "/bin/sh";
+            spec.arguments = QStringList{"-c", systemCommand};
+        } else {
+            spec.program = argv.takeFirst();
+            spec.arguments = argv;
+            spec.useShell = false;
+        }
+
+        int existing = find(spec.key);
+        if (existing >= 0) {
+            specs[existing] = spec;
+            offsetMs[existing] = cooldownMs;
+            lastRunMs[existing] = 0;
+            return;
+        }
+
+        specs.append(spec);
+        offsetMs.append(cooldownMs);
+        lastRunMs.append(0);
+
+        if (specs.size() * 2 > buckets.size()) rehash(int(specs.size()) * 2);
+        else place(int(specs.size()) - 1);
+    }
+
+    // Looks up a raw `$K` payload. Surrounding blanks and letter case are ignored.
+    // Returns the command index or -1.
+    int find(QByteArrayView payload) const {
+        if (buckets.isEmpty()) return -1;
+
+        QByteArrayView key = trimmed(payload);
+        quint32 hash = hashKey(key);
+        for (quint32 i = hash & mask;; i = (i + 1) & mask) {
+            qint32 index = buckets[i];
+            if (index < 0) return -1;
+            if (bucketHashes[i] == hash && equalsKey(specs[index].key, key)) return index;
+        }
+    }
+
+    // Starts the cooldown of `index` if it has expired. Returns false while cooling down.
+    bool tryAcquire(int index, qint64 nowMs) {
+        if (nowMs - lastRunMs[index] <= offsetMs[index]) return false;
+        lastRunMs[index] = nowMs;
+        return true;
+    }
+
+    const CommandSpec &spec(int index) const { return specs[index]; }
+    int size() const { return int(specs.size()); }
+
+    // Upper-cased, trimmed form of a key as used in the table
+    static QByteArray normalizedKey(QByteArrayView key) {
+        QByteArray out = trimmed(key).toByteArray();
+        for (char &c : out) c = upper(c);
+        return out;
+    }
+
+private:
+    static char upper(char c) { return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c; }
+
+    static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    static QByteArrayView trimmed(QByteArrayView v) {
+        qsizetype begin = 0, end = v.size();
+        while (begin < end && isBlank(v[begin])) begin++;
+        while (end > begin && isBlank(v[end - 1])) end--;
+        return v.sliced(begin, end - begin);
+    }
+
+    static quint32 hashKey(QByteArrayView key) {
+        quint32 hash = 2166136261u;
+        for (char c : key) {
+            hash ^= quint8(upper(c));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool equalsKey(const QByteArray &stored, QByteArrayView key) {
+        if (stored.size() != key.size()) return false;
+        for (qsizetype i = 0; i < key.size(); i++) {
+            if (stored[i] != upper(key[i])) return false;
+        }
+        return true;
+    }
+
+    void rehash(int minBuckets) {
+        int size = 8;
+        while (size < minBuckets) size <<= 1;
+        buckets.fill(-1, size);
+        bucketHashes.fill(0, size);
+        mask = quint32(size - 1);
+        for (int i = 0; i < specs.size(); i++) place(i);
+    }
+
+    void place(int index) {
+        quint32 hash = hashKey(specs[index].key);
+        quint32 i = hash & mask;
+        while (buckets[i] >= 0) i = (i + 1) & mask;
+        buckets[i] = index;
+        bucketHashes[i] = hash;
+    }
+
+    QVector<CommandSpec> specs;
+    QVector<qint64> lastRunMs;
+    QVector<qint32> offsetMs;
+
+    QVector<qint32> buckets;        // Command index per bucket, -1 if empty
+    QVector<quint32> bucketHashes;  // Full hash per bucket, compared before the key
+    quint32 mask = 0;
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+// Keeps the link the user asked for alive.
+// After a drop (or a failed open) the same target is re-opened with jittered
+// exponential backoff until it comes back or the user disconnects. Packets
+// sent in the meantime wait in a bounded outbox; when it is full the oldest
+// packet is dropped and counted.
+class ConnectionManager : public QObject {
+    Q_OBJECT
+public:
+    // The port or device a connection was made to, as saved in TelgrafApp.conf
+    struct Target {
+        enum Kind { Bluetooth = 0, Usb = 1 };
+        int kind = Bluetooth;
+        QString port;       // USB serial port name
+        int baud = 9600;
+        QString address;    // Bluetooth device address
+
+        bool isValid() const { return kind == Usb ? !port.isEmpty() : !address.isEmpty(); }
+        QString name() const { return kind == Usb ? port : address; }
+    };
+
+    struct Options {
+        bool autoReconnect = true;
+        int baseDelayMs = 500;      // First retry delay, doubled per attempt
+        int maxDelayMs = 30000;     // Upper bound for the retry delay
+        int outboxFrames = 64;      // Packets kept while the link is down
+    };
+
+    struct Stats {
+        quint64 reconnects = 0;     // Outages that ended with the link back up
+        quint64 attempts = 0;       // Re-open attempts over all outages
+        quint64 droppedFrames = 0;  // Outgoing packets lost to outbox overflow or a disconnect
+        qint64 downtimeMs = 0;      // Total time spent in outages, including the current one
+    };
+
+    static Target savedTarget(const QSettings &settings) {
+        Target target;
+        target.kind = settings.value("Connection/Type", 0).toInt() == Target::Usb ? Target::Usb : Target::Bluetooth;
+        target.port = settings.value("Connection/LastPort").toString();
+        target.baud = settings.value("Connection/Baud", "9600").toInt();
+        target.address = settings.value("Connection/LastAddress").toString();
+        return target;
+    }
+
+    static void saveTarget(QSettings &settings, const Target &target) {
+        settings.setValue("Connection/Type", target.kind);
+        if (target.kind == Target::Usb) {
+            settings.setValue("Connection/LastPort", target.port);
+            settings.setValue("Connection/Baud", QString::number(target.baud));
+        } else {
+            settings.setValue("Connection/LastAddress", target.address);
+        }
+    }
+
+    static Options loadOptions(const QSettings &settings) {
+        Options options;
+        options.autoReconnect = settings.value("Link/AutoReconnect", options.autoReconnect).toBool();
+        options.baseDelayMs = qMax(50, settings.value("Link/ReconnectBaseMs", options.baseDelayMs).toInt());
+        options.maxDelayMs = qMax(options.baseDelayMs, settings.value("Link/ReconnectMaxMs", options.maxDelayMs).toInt());
+        options.outboxFrames = qMax(0, settings.value("Link/OutboxFrames", options.outboxFrames).toInt());
+        return options;
+    }
+
+    explicit ConnectionManager(const Options &options, QObject *parent = nullptr)
+        : QObject(parent), options(options) {
+        retryTimer.setSingleShot(true);
+        connect(&retryTimer, &QTimer::timeout, this, [this]() {
+            stats.attempts++;
+            attempt++;
+            emit openRequested(target);
+        });
+    }
+
+    // Starts supervising `target` and asks for it to be opened
+    void open(const Target &newTarget) {
+        retryTimer.stop();
+        target = newTarget;
+        supervising = true;
+        attempt = 0;
+        emit openRequested(target);
+    }
+
+    // Stops supervising; queued packets are discarded
+    void close() {
+        supervising = false;
+        retryTimer.stop();
+        endOutage();
+        stats.droppedFrames += quint64(outbox.size());
+        outbox.clear();
+    }
+
+    // Reports a link state change from the worker. Returns false if the link
+    // came up although nobody wants it any more, so the caller should close it.
+    bool linkStatusChanged(bool up) {
+        if (up) {
+            if (!supervising) return false;
+            retryTimer.stop();
+            connected = true;
+            if (downSince.isValid()) {
+                qint64 outageMs = downSince.elapsed();
+                int attempts = attempt;
+                endOutage();
+                stats.reconnects++;
+                emit linkRestored(outageMs, attempts);
+            }
+            attempt = 0;
+            return true;
+        }
+
+        connected = false;
+        if (!supervising || retryTimer.isActive()) return true;
+        if (!downSince.isValid()) downSince.start();
+
+        if (!options.autoReconnect) {
+            close();
+            return true;
+        }
+
+        int delay = nextDelayMs();
+        retryTimer.start(delay);
+        emit reconnectScheduled(attempt + 1, delay);
+        return true;
+    }
+
+    // Holds a packet until the link is back. Returns false if no link is supervised.
+    // Packets are kept unframed, the framing may change with the next link.
+    bool enqueue(const QByteArray &packet) {
+        if (!supervising) return false;
+        if (options.outboxFrames == 0) {
+            stats.droppedFrames++;
+            return true;
+        }
+        if (outbox.size() >= options.outboxFrames) {
+            outbox.removeFirst();
+            stats.droppedFrames++;
+        }
+        outbox.append(packet);
+        return true;
+    }
+
+    // Hands over the packets queued during the outage, oldest first
+    QVector<QByteArray> takeQueued() {
+        QVector<QByteArray> packets;
+        packets.swap(outbox);
+        return packets;
+    }
+
+    bool isSupervising() const { return supervising; }
+    bool isReconnecting() const { return supervising && !connected && downSince.isValid(); }
+    int queuedCount() const { return int(outbox.size()); }
+    const Target &currentTarget() const { return target; }
+
+    Stats currentStats() const {
+        Stats current = stats;
+        if (downSince.isValid()) current.downtimeMs += downSince.elapsed();
+        return current;
+    }
+
+signals:
+    void openRequested(ConnectionManager::Target target);
+    void reconnectScheduled(int attempt, int delayMs);
+    void linkRestored(qint64 outageMs, int attempts);
+
+private:
+    // Exponential backoff with "equal jitter": half fixed, half random, so
+    // several stations do not retry in lockstep after a shared outage
+    int nextDelayMs() const {
+        qint64 delay = options.baseDelayMs;
+        for (int i = 0; i < attempt && delay < options.maxDelayMs; i++) delay *= 2;
+        delay = qMin<qint64>(delay, options.maxDelayMs);
+        qint64 half = delay / 2;
+        return int(half + QRandomGenerator::global()->bounded(half + 1));
+    }
+
+    void endOutage() {
+        if (!downSince.isValid()) return;
+        stats.downtimeMs += downSince.elapsed();
+        downSince.invalidate();
+    }
+
+    Options options;
+    Target target;
+    Stats stats;
+    QVector<QByteArray> outbox;
+    QTimer retryTimer;
+    QElapsedTimer downSince;    // Valid while an outage is in progress
+    int attempt = 0;
+    bool supervising = false;
+    bool connected = false;
+};
+Q_DECLARE_METATYPE(ConnectionManager::Target)
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <QtCore/qalgorithms.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+// Monotonic timestamp in nanoseconds, comparable across threads
+inline qint64 monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Latency histogram in the manner of HdrHistogram: each power of two is split
+// into SubBuckets linear steps, so any recorded value is known within 12.5 %
+// from 1 us up to minutes. Fixed size, recording never allocates. Not
+// thread-safe; record and read it on one thread.
+class LatencyHistogram {
+public:
+    static constexpr int SubBits = 3;
+    static constexpr int SubBuckets = 1 << SubBits;
+    static constexpr int UnitShift = 10;    // Finest step 1.024 us
+    static constexpr int Magnitudes = 28;   // Up to 2^(28+SubBits+UnitShift) ns, about 36 minutes
+    static constexpr int BucketCount = SubBuckets * (Magnitudes + 1);
+
+    void record(qint64 ns) {
+        if (ns < 0) ns = 0;
+        buckets[indexOf(ns)]++;
+        count++;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    // Value below which `fraction` (0..1) of the samples fall, to bucket resolution
+    qint64 percentileNs(double fraction) const {
+        if (count == 0) return 0;
+        quint64 rank = qMax<quint64>(1, quint64(std::ceil(fraction * double(count))));
+        quint64 seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += buckets[i];
+            if (seen >= rank) return i == BucketCount - 1 ? maxNs : qMin(upperEdgeNs(i), maxNs);
+        }
+        return maxNs;
+    }
+
+    // Samples in buckets that end at or below `ns`; exact for a bucket edge
+    quint64 countAtOrBelow(qint64 ns) const {
+        quint64 total = 0;
+        for (int i = 0; i < BucketCount && upperEdgeNs(i) <= ns; i++) total += buckets[i];
+        return total;
+    }
+
+    // Largest bucket edge at or below `ns` (the first edge for smaller values)
+    static qint64 edgeAtOrBelowNs(qint64 ns) {
+        int index = indexOf(qMax<qint64>(0, ns));
+        return index == 0 ? upperEdgeNs(0) : upperEdgeNs(index - 1);
+    }
+
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+
+private:
+    static int indexOf(qint64 ns) {
+        quint64 units = quint64(ns) >> UnitShift;
+        if (units < quint64(SubBuckets)) return int(units);
+        int top = 63 - qCountLeadingZeroBits(units);
+        int magnitude = top - SubBits + 1;
+        int sub = int(units >> (top - SubBits)) & (SubBuckets - 1);
+        return qMin(magnitude * SubBuckets + sub, BucketCount - 1);
+    }
+
+    static qint64 upperEdgeNs(int index) {
+        int magnitude = index / SubBuckets;
+        qint64 sub = index % SubBuckets;
+        qint64 units = magnitude == 0 ? sub + 1 : (SubBuckets + sub + 1) << (magnitude - 1);
+        return units << UnitShift;
+    }
+
+    quint64 buckets[BucketCount] = {};
+};
+
+// Link health figures for the metrics panel and the scrape endpoint (see
+// Metrics/Port). Byte counts are bumped by the link worker threads; the rest
+// is only touched on the core's thread.
+struct LinkMetrics {
+    // Link worker threads
+    std::atomic<quint64> bytesIn{0};
+    std::atomic<quint64> bytesOut{0};
+
+    // Core thread
+    quint64 framesIn = 0;               // Frames decoded, damaged ones included
+    quint64 framesOut = 0;              // Packets framed and handed to a worker
+    quint64 checksumErrors = 0;
+    quint64 unknownCommands = 0;
+    quint64 cooldownRejections = 0;     // Command still in its cooldown
+    quint64 busyRejections = 0;         // Commands/MaxConcurrent reached
+    LatencyHistogram parseToDispatch;   // Worker read until the core acts on the frame
+    LatencyHistogram dispatchToSpawn;   // Command dispatched until its process runs
+
+    // Prometheus text exposition format, version 0.0.4
+    QByteArray prometheusText(bool linkUp) const {
+        QByteArray out;
+        auto counter = [&out](const char *name, const char *help, quint64 value, const char *labels = nullptr) {
+            if (help) {
+                out += QByteArray("# HELP ") + name + " " + help + "\n";
+                out += QByteArray("# TYPE ") + name + " counter\n";
+            }
+            out += QByteArray(name) + (labels ? QByteArray("{") + labels + "}" : QByteArray()) + " " + QByteArray::number(value) + "\n";
+        };
+
+        out += "# HELP telgraf_link_up Whether a link to the PIC is open.\n# TYPE telgraf_link_up gauge\n";
+        out += QByteArray("telgraf_link_up ") + (linkUp ? "1" : "0") + "\n";
+        counter("telgraf_link_bytes_total", "Bytes read from and written to the link.", bytesIn.load(std::memory_order_relaxed), "direction=\"in\"");
+        counter("telgraf_link_bytes_total", nullptr, bytesOut.load(std::memory_order_relaxed), "direction=\"out\"");
+        counter("telgraf_link_frames_total", "Frames decoded from and sent to the link.", framesIn, "direction=\"in\"");
+        counter("telgraf_link_frames_total", nullptr, framesOut, "direction=\"out\"");
+        counter("telgraf_checksum_errors_total", "Frames dropped for a bad checksum or CRC.", checksumErrors);
+        counter("telgraf_unknown_commands_total", "$K commands not in Command.json.", unknownCommands);
+        counter("telgraf_command_rejections_total", "Commands not run.", cooldownRejections, "reason=\"cooldown\"");
+        counter("telgraf_command_rejections_total", nullptr, busyRejections, "reason=\"busy\"");
+        appendHistogram(out, "telgraf_parse_to_dispatch_seconds", "Time from reading a frame to acting on it.", parseToDispatch);
+        appendHistogram(out, "telgraf_dispatch_to_spawn_seconds", "Time from dispatching a command to its process running.", dispatchToSpawn);
+        return out;
+    }
+
+private:
+    static void appendHistogram(QByteArray &out, const char *name, const char *help, const LatencyHistogram &histogram) {
+        // Fixed bounds so every scrape has the same series. Each is moved down
+        // to the nearest internal bucket edge (10 us is exported as 9.216 us),
+        // so no bucket straddles a bound and the counts are exact.
+        static const qint64 boundsUs[] = {10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+                                          50000, 100000, 250000, 500000, 1000000, 2500000, 5000000};
+        out += QByteArray("# HELP ") + name + " " + help + "\n";
+        out += QByteArray("# TYPE ") + name + " histogram\n";
+        for (qint64 us : boundsUs) {
+            qint64 edgeNs = LatencyHistogram::edgeAtOrBelowNs(us * 1000);
+            out += QByteArray(name) + "_bucket{le=\"" + QByteArray::number(double(edgeNs) / 1e9, 'g', 10) + "\"} "
+                   + QByteArray::number(histogram.countAtOrBelow(edgeNs)) + "\n";
+        }
+        out += QByteArray(name) + "_bucket{le=\"+Inf\"} " + QByteArray::number(histogram.count) + "\n";
+        out += QByteArray(name) + "_sum " + QByteArray::number(double(histogram.totalNs) / 1e9, 'f', 6) + "\n";
+        out += QByteArray(name) + "_count " + QByteArray::number(histogram.count) + "\n";
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QObject>
+#include <QIODevice>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include "LinkMetrics.h"
+#include "NmeaParser.h"
+#include "TrafficCapture.h"
+
+// Accumulates read-to-handle latency of frames on the UI side
+struct LatencyCounter {
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+
+    void add(qint64 ns) {
+        count++;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    qint64 averageUs() const { return count ? totalNs / qint64(count) / 1000 : 0; }
+    qint64 maxUs() const { return maxNs / 1000; }
+
+    void reset() { *this = LatencyCounter(); }
+};
+
+// Base class for transport workers living on their own thread.
+// Subclasses own the QIODevice; this class reads it, frames and checksums
+// the bytes and only posts decoded frames back to the UI thread, in batches:
+// a batch is handed over when `batchMaxFrames` frames are pending or
+// `batchIntervalMs` after the first frame of the batch arrived.
+class LinkWorker : public QObject {
+    Q_OBJECT
+public:
+    explicit LinkWorker(QObject *parent = nullptr) : QObject(parent) {
+        batchTimer = new QTimer(this);
+        batchTimer->setSingleShot(true);
+        batchTimer->setTimerType(Qt::PreciseTimer);
+        connect(batchTimer, &QTimer::timeout, this, &LinkWorker::flushFrames);
+    }
+
+    // Must be called before the worker is moved to its thread
+    void setBatching(int intervalMs, int maxFrames) {
+        batchIntervalMs = qMax(0, intervalMs);
+        batchMaxFrames = qMax(1, maxFrames);
+        pendingFrames.reserve(batchMaxFrames);
+    }
+
+    // Byte counters to feed; must be set before the worker is moved to its thread
+    void setMetrics(LinkMetrics *linkMetrics) {
+        metrics = linkMetrics;
+    }
+
+    // Raw capture to append to while it is active; set before moving to the thread
+    void setCapture(TrafficCapture *trafficCapture) {
+        capture = trafficCapture;
+    }
+
+public slots:
+    // Writes an already framed packet to the open link
+    void writeData(QByteArray data) {
+        QIODevice *dev = device();
+        if (dev && dev->isOpen()) {
+            qint64 written = dev->write(data);
+            if (written > 0 && metrics) metrics->bytesOut.fetch_add(quint64(written), std::memory_order_relaxed);
+            if (written > 0 && capture) capture->record(TrafficCapture::ToPic, QByteArrayView(data).first(written), monotonicNs());
+        }
+    }
+
+    // Hands the pending frames over to the UI thread
+    void flushFrames() {
+        batchTimer->stop();
+        if (pendingFrames.isEmpty()) return;
+        emit framesReceived(pendingFrames);
+        pendingFrames.clear();
+        pendingFrames.reserve(batchMaxFrames);
+    }
+
+signals:
+    void framesReceived(QVector<LinkFrame> frames);
+    void connectionStatusChanged(bool connected, QString linkName);
+    void errorOccurred(QString error);
+
+protected:
+    // The underlying device, or nullptr if none has been created yet
+    virtual QIODevice *device() const = 0;
+
+    // Drains the device and emits every frame found in the data
+    void readAvailable() {
+        QIODevice *dev = device();
+        char buffer[512];
+        qint64 count;
+        while ((count = dev->read(buffer, sizeof(buffer))) > 0) {
+            const qint64 stamp = monotonicNs();
+            if (metrics) metrics->bytesIn.fetch_add(quint64(count), std::memory_order_relaxed);
+            if (capture) capture->record(TrafficCapture::FromPic, QByteArrayView(buffer, count), stamp);
+            parser.feed(QByteArrayView(buffer, count), [this, stamp](const LinkFrame &frame) {
+                pendingFrames.append(frame);
+                pendingFrames.last().receivedNs = stamp;
+                if (pendingFrames.size() >= batchMaxFrames) flushFrames();
+            });
+        }
+
+        if (pendingFrames.isEmpty()) return;
+        if (batchIntervalMs == 0) flushFrames();
+        else if (!batchTimer->isActive()) batchTimer->start(batchIntervalMs);
+    }
+
+    NmeaParser parser;
+    QVector<LinkFrame> pendingFrames;
+    QTimer *batchTimer;
+    int batchIntervalMs = 16;
+    int batchMaxFrames = 32;
+    LinkMetrics *metrics = nullptr;
+    TrafficCapture *capture = nullptr;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+// List model backed by a fixed-size ring buffer.
+// Once `capacity` rows are stored, each append drops the oldest rows, so the
+// chat and log views never grow past the configured retention.
+class MessageRingModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        TimeRole = Qt::UserRole + 1,    // "HH:mm" for chat bubbles
+        OutgoingRole,                   // true for messages sent from this side
+        SeparatorRole                   // true for "--- date ---" log rows
+    };
+
+    struct Entry {
+        QString text;
+        QString time;
+        bool outgoing = false;
+        bool separator = false;
+    };
+
+    explicit MessageRingModel(int capacity, QObject *parent = nullptr)
+        : QAbstractListModel(parent), cap(qMax(1, capacity)) {
+        items.resize(cap);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : count;
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override {
+        if (!index.isValid() || index.row() >= count) return QVariant();
+        const Entry &e = at(index.row());
+        switch (role) {
+        case Qt::DisplayRole:
+        case Qt::ToolTipRole:
+            return e.text;
+        case Qt::TextAlignmentRole:
+            return e.separator ? int(Qt::AlignCenter) : int(Qt::AlignLeft | Qt::AlignVCenter);
+        case TimeRole:
+            return e.time;
+        case OutgoingRole:
+            return e.outgoing;
+        case SeparatorRole:
+            return e.separator;
+        default:
+            return QVariant();
+        }
+    }
+
+    void append(const Entry &entry) {
+        append(QVector<Entry>{entry});
+    }
+
+    // Appends several rows with a single remove/insert notification
+    void append(const QVector<Entry> &entries) {
+        if (entries.isEmpty()) return;
+
+        // Only the newest `cap` entries can survive anyway
+        int first = qMax(0, int(entries.size()) - cap);
+        int incoming = int(entries.size()) - first;
+
+        int overflow = count + incoming - cap;
+        if (overflow > 0) {
+            beginRemoveRows(QModelIndex(), 0, overflow - 1);
+            for (int i = 0; i < overflow; i++) {
+                items[head] = Entry();
+                head = (head + 1) % cap;
+            }
+            count -= overflow;
+            endRemoveRows();
+        }
+
+        beginInsertRows(QModelIndex(), count, count + incoming - 1);
+        for (int i = first; i < entries.size(); i++) {
+            items[(head + count) % cap] = entries[i];
+            count++;
+        }
+        endInsertRows();
+    }
+
+    void clear() {
+        beginResetModel();
+        items.fill(Entry());
+        head = 0;
+        count = 0;
+        endResetModel();
+    }
+
+    int capacity() const { return cap; }
+
+private:
+    const Entry &at(int row) const { return items[(head + row) % cap]; }
+
+    QVector<Entry> items;
+    int cap;
+    int head = 0;
+    int count = 0;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <QAbstractItemView>
+#include <QListView>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include <QTimer>
+
+#include "MessageModel.h"
+
+// List view that follows new rows at most once per frame.
+// Appends only arm a 16 ms single-shot timer, so a burst of rows costs one
+// scroll and one repaint instead of one per row.
+class AutoScrollListView : public QListView {
+    Q_OBJECT
+public:
+    explicit AutoScrollListView(QWidget *parent = nullptr) : QListView(parent) {
+        setUniformItemSizes(false);
+        setLayoutMode(QListView::Batched);
+        setResizeMode(QListView::Adjust);
+        setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setWordWrap(true);
+        setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+        scrollTimer.setSingleShot(true);
+        scrollTimer.setInterval(16);
+        connect(&scrollTimer, &QTimer::timeout, this, &QListView::scrollToBottom);
+    }
+
+    void setModel(QAbstractItemModel *model) override {
+        QListView::setModel(model);
+        connect(model, &QAbstractItemModel::rowsInserted, this, [this]() {
+            if (!scrollTimer.isActive()) scrollTimer.start();
+        });
+    }
+
+private:
+    QTimer scrollTimer;
+};
+
+// Paints chat rows as left/right aligned bubbles with a small timestamp
+class ChatDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+public:
+    explicit ChatDelegate(QAbstractItemView *view) : QStyledItemDelegate(view), view(view) {}
+
+    void setDarkTheme(bool dark) { isDarkTheme = dark; }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const bool isMe = index.data(MessageRingModel::OutgoingRole).toBool();
+        const QString text = index.data(Qt::DisplayRole).toString();
+        const QString time = index.data(MessageRingModel::TimeRole).toString();
+
+        QColor bgColor = isMe ? QColor(isDarkTheme ? "#313244" : "#bcc0cc") : QColor(isDarkTheme ? "#45475a" : "#9ca0b0");
+        QColor textColor = QColor(isDarkTheme ? "#cdd6f4" : "#303446");
+
+        QRect textRect, timeRect;
+        QRect bubble = layoutBubble(option, text, time, isMe, &textRect, &timeRect);
+
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(bgColor);
+        painter->drawRoundedRect(bubble, 8, 8);
+
+        painter->setPen(textColor);
+        painter->setFont(textFont(option));
+        painter->drawText(textRect, Qt::TextWordWrap, text);
+
+        textColor.setAlphaF(0.7);
+        painter->setPen(textColor);
+        painter->setFont(timeFont(option));
+        painter->drawText(timeRect, Qt::AlignLeft, time);
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        const QString text = index.data(Qt::DisplayRole).toString();
+        const QString time = index.data(MessageRingModel::TimeRole).toString();
+        QStyleOptionViewItem opt = option;
+        opt.rect = QRect(0, 0, availableWidth(), 0);
+        QRect bubble = layoutBubble(opt, text, time, false, nullptr, nullptr);
+        return QSize(opt.rect.width(), bubble.height() + RowSpacing);
+    }
+
+private:
+    static constexpr int Padding = 10;
+    static constexpr int RowSpacing = 10;
+
+    int availableWidth() const { return qMax(100, view->viewport()->width()); }
+
+    static QFont textFont(const QStyleOptionViewItem &option) {
+        QFont font = option.font;
+        font.setPixelSize(14);
+        return font;
+    }
+
+    static QFont timeFont(const QStyleOptionViewItem &option) {
+        QFont font = option.font;
+        font.setPixelSize(10);
+        return font;
+    }
+
+    // Computes the bubble rectangle inside option.rect and the text/time rectangles inside it
+    QRect layoutBubble(const QStyleOptionViewItem &option, const QString &text, const QString &time,
+                       bool isMe, QRect *textRect, QRect *timeRect) const {
+        const int rowWidth = option.rect.width() > 0 ? option.rect.width() : availableWidth();
+        const int maxTextWidth = qMax(40, rowWidth * 3 / 4 - 2 * Padding);
+
+        QFontMetrics textMetrics(textFont(option));
+        QFontMetrics timeMetrics(timeFont(option));
+        QRect textBounds = textMetrics.boundingRect(QRect(0, 0, maxTextWidth, 100000), Qt::TextWordWrap, text);
+        QRect timeBounds = timeMetrics.boundingRect(time);
+
+        const int width = qMax(textBounds.width(), timeBounds.width()) + 2 * Padding;
+        const int height = textBounds.height() + timeBounds.height() + 2 * Padding;
+        const int left = isMe ? option.rect.right() - width : option.rect.left();
+
+        QRect bubble(left, option.rect.top(), width, height);
+        if (textRect) *textRect = QRect(bubble.left() + Padding, bubble.top() + Padding, width - 2 * Padding, textBounds.height());
+        if (timeRect) *timeRect = QRect(bubble.left() + Padding, bubble.top() + Padding + textBounds.height(), width - 2 * Padding, timeBounds.height());
+        return bubble;
+    }
+
+    QAbstractItemView *view;
+    bool isDarkTheme = true;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <functional>
+
+// Minimal HTTP endpoint for Prometheus scrapes, see Metrics/Port. Answers
+// "GET /metrics" with whatever `render` returns and closes the connection;
+// anything else gets a 404. Lives on the core's thread, so `render` can read
+// the core's state directly.
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    MetricsServer(std::function<QByteArray()> render, QObject *parent = nullptr)
+        : QObject(parent), render(std::move(render)) {
+        connect(&server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnections);
+    }
+
+    bool listen(const QHostAddress &address, quint16 port) { return server.listen(address, port); }
+    QString errorString() const { return server.errorString(); }
+
+private:
+    void acceptConnections() {
+        while (QTcpSocket *socket = server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { answer(socket); });
+        }
+    }
+
+    // Replies once the request line is complete; headers and body are ignored
+    void answer(QTcpSocket *socket) {
+        if (!socket->canReadLine()) {
+            if (socket->bytesAvailable() > 4096) socket->abort();
+            return;
+        }
+        QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+        disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+        QByteArray status = "200 OK";
+        QByteArray body;
+        if (request.size() < 2 || request[0] != "GET") {
+            status = "405 Method Not Allowed";
+        } else if (request[1] != "/metrics" && !request[1].startsWith("/metrics?")) {
+            status = "404 Not Found";
+        } else {
+            body = render();
+        }
+
+        socket->write("HTTP/1.0 " + status + "\r\n"
+                      "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                      "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + body);
+        socket->disconnectFromHost();
+    }
+
+    QTcpServer server;
+    std::function<QByteArray()> render;
+};
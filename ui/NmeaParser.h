@@ -0,0 +1,216 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QMetaType>
+#include <QString>
+#include <QtGlobal>
+#include <cstring>
+
+#include "BinaryFraming.h"
+
+// A single packet taken off the link ("$K,BR*XX" -> type 'K', payload "BR").
+// The payload is stored inline so building a frame never touches the heap.
+struct LinkFrame {
+    enum Status : quint8 {
+        Valid,          // Checksum matched
+        BadChecksum     // Well formed, but the XOR checksum (or CRC) did not match
+    };
+
+    static constexpr int MaxPayload = 64;
+
+    char type = 0;          // Packet type character right after '$' ('M', 'K', ...)
+    Status status = Valid;
+    quint8 length = 0;      // Number of payload bytes in use
+    bool binary = false;    // Arrived as a COBS/CRC-16 frame instead of text
+    char payload[MaxPayload];
+    qint64 receivedNs = 0;  // Monotonic time the bytes were read off the device
+
+    bool isMessage() const { return type == 'M'; }
+    bool isCommand() const { return type == 'K'; }
+    bool isStatus() const { return type == 'S'; }
+    bool isQueued() const { return type == 'Q'; }  // "seq,T,text" from the PIC outbox
+    bool isAck() const { return type == 'A'; }     // The PIC got our reliable packet "seq"
+    bool isNak() const { return type == 'N'; }     // The PIC got a damaged frame, still misses "seq"
+
+    QByteArrayView payloadView() const { return QByteArrayView(payload, length); }
+
+    // Decoded payload for display; only call this on the UI side
+    QString text() const { return QString::fromUtf8(payload, length); }
+};
+Q_DECLARE_METATYPE(LinkFrame)
+
+// Incremental parser for the "$type,payload*CS\r\n" protocol spoken by the PIC.
+// Bytes can be fed in arbitrary chunks straight from the device; the parser keeps
+// its state between calls, XORs the checksum while the payload streams in and only
+// hands out a frame once the trailing checksum has been read and compared.
+// Binary frames (see BinaryFraming.h) are accepted on the same stream: a 0x00
+// switches to collecting COBS bytes until the next 0x00, unless the first byte
+// after it is '$'.
+class NmeaParser {
+public:
+    // Feeds raw bytes into the state machine. `onFrame` is called with a
+    // `const LinkFrame &` for every complete packet, valid or not (see status).
+    template <typename Handler>
+    void feed(QByteArrayView data, Handler &&onFrame) {
+        const char *p = data.data();
+        const char *end = p + data.size();
+
+        for (; p != end; ++p) {
+            const char c = *p;
+
+            // 0x00 never occurs in text frames; it delimits binary frames
+            if (c == '\0') {
+                if (state == Binary && binaryLength > 0) finishBinary(onFrame);
+                else if (state != Idle && state != Binary) malformedCount++;
+                state = Binary;
+                binaryLength = 0;
+                continue;
+            }
+
+            // Inside a binary frame every other byte, '$' included, is data
+            if (state == Binary && (binaryLength > 0 || c != '$')) {
+                if (binaryLength < BinaryFraming::MaxEncoded) binary[binaryLength++] = c;
+                else malformed();
+                continue;
+            }
+
+            // '$' always starts a new packet, same as the firmware's serial_isr
+            if (c == '$') {
+                if (state != Idle && state != Binary) malformedCount++;
+                state = Type;
+                trailing = false;
+                checksum = 0;
+                frame.length = 0;
+                frame.binary = false;
+                continue;
+            }
+
+            switch (state) {
+            case Idle:
+            case Binary:
+                break;
+
+            case Type:
+                if (isLineEnd(c)) { malformed(); break; }
+                frame.type = c;
+                checksum ^= quint8(c);
+                state = Separator;
+                break;
+
+            case Separator:
+                if (c != ',') { malformed(); break; }
+                checksum ^= quint8(c);
+                state = Payload;
+                break;
+
+            case Payload:
+                if (c == '*') {
+                    received = 0;
+                    digits = 0;
+                    state = Checksum;
+                } else if (isLineEnd(c) || frame.length >= LinkFrame::MaxPayload) {
+                    malformed();
+                } else {
+                    frame.payload[frame.length++] = c;
+                    checksum ^= quint8(c);
+                }
+                break;
+
+            case Checksum: {
+                // Desktop side prints the checksum without zero padding, so
+                // accept one or two hex digits followed by optional blanks
+                int nibble = hexValue(c);
+                if (nibble >= 0 && digits < 2 && !trailing) {
+                    received = quint8((received << 4) | nibble);
+                    digits++;
+                } else if ((c == ' ' || c == '\t') && digits > 0) {
+                    trailing = true;
+                } else if (isLineEnd(c) && digits > 0) {
+                    frame.status = (received == checksum) ? LinkFrame::Valid : LinkFrame::BadChecksum;
+                    if (frame.status == LinkFrame::Valid) validCount++;
+                    else checksumErrorCount++;
+                    state = Idle;
+                    trailing = false;
+                    onFrame(frame);
+                } else {
+                    malformed();
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    // Drops any partially received packet (e.g. after a reconnect)
+    void reset() {
+        state = Idle;
+        trailing = false;
+        frame.length = 0;
+        binaryLength = 0;
+    }
+
+    quint64 validFrames() const { return validCount; }
+    quint64 binaryFrames() const { return binaryCount; }
+    quint64 checksumErrors() const { return checksumErrorCount; }
+    quint64 malformedFrames() const { return malformedCount; }
+
+private:
+    enum State : quint8 { Idle, Type, Separator, Payload, Checksum, Binary };
+
+    static bool isLineEnd(char c) { return c == '\r' || c == '\n'; }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    void malformed() {
+        malformedCount++;
+        state = Idle;
+        trailing = false;
+        binaryLength = 0;
+    }
+
+    // Decodes the collected COBS bytes and checks length and CRC
+    template <typename Handler>
+    void finishBinary(Handler &onFrame) {
+        int n = BinaryFraming::decodeInPlace(binary, binaryLength);
+        binaryLength = 0;
+        if (n < BinaryFraming::Overhead || quint8(binary[1]) != n - BinaryFraming::Overhead) {
+            malformedCount++;
+            return;
+        }
+
+        const quint16 received = quint16((quint8(binary[n - 2]) << 8) | quint8(binary[n - 1]));
+        frame.type = binary[0];
+        frame.length = quint8(n - BinaryFraming::Overhead);
+        frame.binary = true;
+        memcpy(frame.payload, binary + 2, frame.length);
+
+        frame.status = (BinaryFraming::crc16(binary, n - 2) == received) ? LinkFrame::Valid : LinkFrame::BadChecksum;
+        if (frame.status == LinkFrame::Valid) {
+            validCount++;
+            binaryCount++;
+        } else {
+            checksumErrorCount++;
+        }
+        onFrame(frame);
+    }
+
+    LinkFrame frame;
+    State state = Idle;
+    quint8 checksum = 0;
+    quint8 received = 0;
+    quint8 digits = 0;
+    bool trailing = false;
+
+    char binary[BinaryFraming::MaxEncoded];
+    int binaryLength = 0;
+
+    quint64 validCount = 0;
+    quint64 binaryCount = 0;
+    quint64 checksumErrorCount = 0;
+    quint64 malformedCount = 0;
+};
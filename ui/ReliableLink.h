@@ -0,0 +1,229 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSettings>
+#include <QTimer>
+#include <QVector>
+
+// Optional reliable delivery of packets sent to the PIC, see Link/Reliable.
+// On every new link arq_set is offered, and resent every timeoutMs until the
+// PIC answers; packets sent meanwhile wait in order. If it never answers (old
+// firmware, or the answers were lost) the waiting packets are handed back to
+// go out plain after setupTries offers. Once the PIC has answered arq_set,
+// every packet goes out as "D,seq,T,payload" and stays in flight until
+// "$A,seq" comes back. Only
+// `window` packets are in flight at once, the PIC has no room to hold more
+// (its receive queue takes three frames); the rest wait in order. A packet is
+// resent when its ack is late or when the PIC reports a damaged frame with
+// "$N,seq", and dropped after maxTries sends.
+class ReliableLink : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int SeqLimit = 64;     // Sequence numbers 0..63, as on the PIC
+    static constexpr int MaxWindow = 3;     // The PIC tracks 8 numbers, its queue holds 3 frames
+
+    struct Options {
+        bool enabled = false;
+        int window = MaxWindow;     // Packets in flight
+        int timeoutMs = 800;        // Resend a packet whose ack did not arrive in this time
+        int maxTries = 5;           // Sends per packet before it is dropped
+        int setupTries = 3;         // arq_set offers per link before packets go out plain
+    };
+
+    struct Stats {
+        quint64 packets = 0;        // Packets sent for the first time
+        quint64 retransmits = 0;    // Further sends after a timeout or NAK
+        quint64 acked = 0;
+        quint64 failed = 0;         // Dropped after maxTries sends
+        quint64 naks = 0;
+        quint64 wireBytes = 0;      // Bytes of all sends, as text frames
+        quint64 goodBytes = 0;      // Payload bytes of acked packets
+    };
+
+    static Options loadOptions(const QSettings &settings) {
+        Options options;
+        options.enabled = settings.value("Link/Reliable", options.enabled).toBool();
+        options.window = qBound(1, settings.value("Link/ReliableWindow", options.window).toInt(), int(MaxWindow));
+        options.timeoutMs = qMax(50, settings.value("Link/ReliableTimeoutMs", options.timeoutMs).toInt());
+        options.maxTries = qMax(1, settings.value("Link/ReliableTries", options.maxTries).toInt());
+        options.setupTries = qMax(1, settings.value("Link/ReliableSetupTries", options.setupTries).toInt());
+        return options;
+    }
+
+    explicit ReliableLink(const Options &options, QObject *parent = nullptr)
+        : QObject(parent), options(options) {
+        clock.start();
+        resendTimer.setSingleShot(true);
+        connect(&resendTimer, &QTimer::timeout, this, &ReliableLink::resendLate);
+        setupTimer.setSingleShot(true);
+        connect(&setupTimer, &QTimer::timeout, this, &ReliableLink::offerAgain);
+    }
+
+    bool isEnabled() const { return options.enabled; }
+    bool isActive() const { return active; }
+    bool isNegotiating() const { return negotiating; }
+
+    // New link: offers arq_set. Until the PIC accepts (start) or the offers
+    // run out (setupFailed), sent packets wait in the backlog.
+    void offer() {
+        active = false;
+        negotiating = true;
+        setupSends = 0;
+        offerAgain();
+    }
+
+    // The PIC accepted arq_set on a new link: number packets from 0
+    void start() {
+        negotiating = false;
+        setupTimer.stop();
+        active = true;
+        nextSeq = 0;
+        fill();
+    }
+
+    // Link down: returns the packets not acked yet, oldest first, so they can
+    // wait for the next link with the other queued packets
+    QVector<QByteArray> stop() {
+        active = false;
+        negotiating = false;
+        setupTimer.stop();
+        resendTimer.stop();
+        QVector<QByteArray> unacked;
+        for (const Packet &packet : inFlight) unacked.append(packet.body);
+        unacked += backlog;
+        inFlight.clear();
+        backlog.clear();
+        return unacked;
+    }
+
+    // Sends a "T,payload" body, or holds it until the window has room (or
+    // the PIC has answered arq_set)
+    void send(const QByteArray &body) {
+        backlog.append(body);
+        fill();
+    }
+
+    void acknowledge(int seq) {
+        for (int i = 0; i < inFlight.size(); i++) {
+            if (inFlight[i].seq != seq) continue;
+            stats.acked++;
+            stats.goodBytes += quint64(inFlight[i].body.size() - 2);
+            inFlight.removeAt(i);
+            fill();
+            return;
+        }
+        // Ack of a resent copy that was acked already
+    }
+
+    // The PIC got a damaged frame and still misses `seq`
+    void negativeAcknowledge(int seq) {
+        stats.naks++;
+        for (Packet &packet : inFlight) {
+            if (packet.seq == seq && packet.tries < options.maxTries) {
+                stats.retransmits++;
+                transmit(packet);
+                break;
+            }
+        }
+        armResendTimer();
+    }
+
+    int pendingCount() const { return int(inFlight.size() + backlog.size()); }
+    Stats currentStats() const { return stats; }
+
+signals:
+    // A "D,seq,T,payload" body to frame and write
+    void writeRequested(QByteArray body);
+    void packetFailed(QByteArray body, int tries);
+    // The PIC never answered arq_set; `waiting` are the packets sent since
+    // the link came up, oldest first, to go out plain
+    void setupFailed(QVector<QByteArray> waiting, int offers);
+
+private:
+    struct Packet {
+        int seq = 0;
+        QByteArray body;
+        int tries = 0;
+        qint64 sentMs = 0;
+    };
+
+    // Moves waiting packets into the window
+    void fill() {
+        while (active && inFlight.size() < options.window && !backlog.isEmpty()) {
+            Packet packet;
+            packet.seq = nextSeq;
+            packet.body = backlog.takeFirst();
+            nextSeq = (nextSeq + 1) % SeqLimit;
+            stats.packets++;
+            inFlight.append(packet);
+            transmit(inFlight.last());
+        }
+        armResendTimer();
+    }
+
+    void offerAgain() {
+        if (!negotiating) return;
+        if (setupSends >= options.setupTries) {
+            negotiating = false;
+            QVector<QByteArray> waiting = backlog;
+            backlog.clear();
+            emit setupFailed(waiting, setupSends);
+            return;
+        }
+        setupSends++;
+        emit writeRequested("K,arq_set,1");
+        setupTimer.start(options.timeoutMs);
+    }
+
+    void transmit(Packet &packet) {
+        packet.tries++;
+        packet.sentMs = clock.elapsed();
+        QByteArray body = "D," + QByteArray::number(packet.seq) + "," + packet.body;
+        stats.wireBytes += quint64(body.size() + 6); // "$" and "*CS\r\n"
+        emit writeRequested(body);
+    }
+
+    void resendLate() {
+        qint64 now = clock.elapsed();
+        for (int i = 0; i < inFlight.size();) {
+            Packet &packet = inFlight[i];
+            if (now - packet.sentMs < options.timeoutMs) {
+                i++;
+            } else if (packet.tries >= options.maxTries) {
+                stats.failed++;
+                Packet dropped = inFlight.takeAt(i);
+                emit packetFailed(dropped.body, dropped.tries);
+            } else {
+                stats.retransmits++;
+                transmit(packet);
+                i++;
+            }
+        }
+        fill();
+    }
+
+    // Wakes up when the oldest send times out
+    void armResendTimer() {
+        if (inFlight.isEmpty()) {
+            resendTimer.stop();
+            return;
+        }
+        qint64 oldest = inFlight.first().sentMs;
+        for (const Packet &packet : inFlight) oldest = qMin(oldest, packet.sentMs);
+        resendTimer.start(int(qMax<qint64>(0, oldest + options.timeoutMs - clock.elapsed())));
+    }
+
+    Options options;
+    Stats stats;
+    QVector<Packet> inFlight;
+    QVector<QByteArray> backlog;
+    QTimer resendTimer;
+    QTimer setupTimer;          // Next arq_set offer while the PIC has not answered
+    QElapsedTimer clock;
+    int nextSeq = 0;
+    int setupSends = 0;
+    bool active = false;
+    bool negotiating = false;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QSerialPort>
+
+#include "LinkWorker.h"
+
+// Worker class to handle Serial Port operations in a separate thread
+class SerialWorker : public LinkWorker {
+    Q_OBJECT
+public:
+    QSerialPort *serialPort;
+
+    SerialWorker() {
+        // Parented so moveToThread takes the port along to the worker thread
+        serialPort = new QSerialPort(this);
+
+        // An unplugged adapter only reports a resource error; treat it as a lost link
+        connect(serialPort, &QSerialPort::errorOccurred, this, [this](QSerialPort::SerialPortError error) {
+            if (error == QSerialPort::ResourceError && serialPort->isOpen()) {
+                emit errorOccurred("SERIAL PORT ERROR: " + serialPort->errorString());
+                closePort();
+            }
+        });
+    }
+    ~SerialWorker() {
+        if(serialPort->isOpen()) serialPort->close();
+        delete serialPort;
+    }
+
+public slots:
+    // Opens the serial port with specified parameters
+    void openPort(QString name, int baud) {
+        serialPort->setPortName(name);
+        serialPort->setBaudRate(baud);
+        serialPort->setDataBits(QSerialPort::Data8);
+        serialPort->setParity(QSerialPort::NoParity);
+        serialPort->setStopBits(QSerialPort::OneStop);
+
+        if(serialPort->open(QIODevice::ReadWrite)) {
+            parser.reset();
+            emit connectionStatusChanged(true, name);
+            connect(serialPort, &QSerialPort::readyRead, this, &SerialWorker::readData);
+        } else {
+            emit connectionStatusChanged(false, "");
+            emit errorOccurred("SERIAL PORT ERROR: " + serialPort->errorString());
+        }
+    }
+
+    // Closes the serial port
+    void closePort() {
+        if(serialPort->isOpen()) {
+            serialPort->close();
+            disconnect(serialPort, &QSerialPort::readyRead, this, &SerialWorker::readData);
+        }
+        emit connectionStatusChanged(false, "");
+    }
+
+    // Feeds whatever bytes are available into the frame parser
+    void readData() {
+        readAvailable();
+    }
+
+protected:
+    QIODevice *device() const override { return serialPort; }
+};
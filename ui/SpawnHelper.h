@@ -0,0 +1,273 @@
+#pragma once
+
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+
+#include <QByteArray>
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QString>
+#include <QStringList>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Small helper process that starts configured commands with posix_spawn.
+// It is forked from main() before QApplication exists, so it is a tiny,
+// single-threaded copy of the program: spawning from it avoids duplicating the
+// GUI process and the /bin/sh hop. The app talks to it over a socketpair:
+//   request:  [quint32 id][argv0 \0 argv1 \0 ...]
+//   response: Result (started pid / exit status / spawn error + duration)
+// The pair is SOCK_SEQPACKET, or SOCK_STREAM where that is missing (requests
+// then carry a quint32 length in front); both report the helper's exit as
+// end-of-file, so commands it never answered for can be failed.
+class SpawnHelper : public QObject {
+    Q_OBJECT
+public:
+    struct Result {
+        quint32 id;
+        qint32 pid;
+        qint32 kind;        // Started, Exited, Failed or Lost
+        qint32 status;      // waitpid status for Exited, errno for Failed
+        qint64 durationNs;  // Time between spawn and exit
+    };
+
+    // Lost: the helper exited before it reported how the command ended
+    enum Kind { Started = 0, Exited = 1, Failed = 2, Lost = 3 };
+
+    // Forks the helper. Must run before any thread is started; returns false
+    // if the helper could not be created (the app then falls back to QProcess).
+    static bool launch() {
+        int fds[2];
+        streamSocket() = false;
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+            streamSocket() = true;
+        }
+
+        // Neither end should leak into spawned commands, and writing to a
+        // closed end must fail with EPIPE instead of killing the process
+        for (int fd : fds) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            serve(fds[1]);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        parentFd() = fds[0];
+        return true;
+    }
+
+    static bool isAvailable() { return parentFd() >= 0; }
+
+    explicit SpawnHelper(QObject *parent = nullptr) : QObject(parent) {
+        if (isAvailable()) {
+            notifier = new QSocketNotifier(parentFd(), QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, &SpawnHelper::readResults);
+        }
+    }
+
+    // Queues a spawn request; the outcome arrives through resultReady
+    bool spawn(quint32 id, const QString &program, const QStringList &arguments) {
+        if (!isAvailable()) return false;
+
+        QByteArray request(reinterpret_cast<const char *>(&id), sizeof(id));
+        request.append(program.toLocal8Bit()).append('\0');
+        for (const QString &arg : arguments) {
+            request.append(arg.toLocal8Bit()).append('\0');
+        }
+        if (streamSocket()) {
+            quint32 length = quint32(request.size());
+            request.prepend(reinterpret_cast<const char *>(&length), sizeof(length));
+        }
+        if (!sendAll(parentFd(), request.constData(), size_t(request.size()))) return false;
+        outstanding.insert(id);
+        return true;
+    }
+
+signals:
+    void resultReady(SpawnHelper::Result result);
+
+private:
+    static int &parentFd() {
+        static int fd = -1;
+        return fd;
+    }
+
+    static bool &streamSocket() {
+        static bool stream = false;
+        return stream;
+    }
+
+    static bool sendAll(int fd, const char *data, size_t length) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        while (length > 0) {
+            ssize_t n = ::send(fd, data, length, flags);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            length -= size_t(n);
+        }
+        return true;
+    }
+
+    void readResults() {
+        char chunk[16 * sizeof(Result)];
+        bool lost = false;
+        for (;;) {
+            ssize_t n = ::recv(parentFd(), chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (n > 0) {
+                received.append(chunk, qsizetype(n));
+                continue;
+            }
+            lost = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+            break;
+        }
+
+        qsizetype at = 0;
+        for (; received.size() - at >= qsizetype(sizeof(Result)); at += qsizetype(sizeof(Result))) {
+            Result result;
+            memcpy(&result, received.constData() + at, sizeof(result));
+            if (result.kind != Started) outstanding.remove(result.id);
+            emit resultReady(result);
+        }
+        received.remove(0, at);
+
+        if (lost) {
+            // Helper went away; new commands fall back to QProcess, and the
+            // ones it never reported on are given up so they stop counting
+            // as running
+            notifier->setEnabled(false);
+            close(parentFd());
+            parentFd() = -1;
+            received.clear();
+            const QSet<quint32> ids = outstanding;
+            outstanding.clear();
+            for (quint32 id : ids) {
+                emit resultReady(Result{ id, 0, Lost, 0, 0 });
+            }
+        }
+    }
+
+    static qint64 nowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // Reads one request into `buffer`; returns its length, or <= 0 once the
+    // app has closed its end
+    static ssize_t readRequest(int fd, std::vector<char> &buffer) {
+        if (!streamSocket()) return recv(fd, buffer.data(), buffer.size() - 1, 0);
+
+        quint32 length;
+        ssize_t n = recv(fd, &length, sizeof(length), MSG_WAITALL);
+        if (n != ssize_t(sizeof(length))) return 0;
+        if (length >= buffer.size()) return 0;  // Out of step with the app
+        n = recv(fd, buffer.data(), length, MSG_WAITALL);
+        return n == ssize_t(length) ? n : 0;
+    }
+
+    // Helper process main loop: spawn on request, reap children, report back
+    static void serve(int fd) {
+        struct Child { pid_t pid; quint32 id; qint64 startNs; };
+        std::vector<Child> children;
+        std::vector<char> buffer(64 * 1024);
+        std::vector<char *> argv;
+
+        signal(SIGINT, SIG_IGN);
+        signal(SIGCHLD, SIG_DFL);
+
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        sigset_t none;
+        sigemptyset(&none);
+        sigset_t all;
+        sigfillset(&all);
+        posix_spawnattr_setsigmask(&attr, &none);
+        posix_spawnattr_setsigdefault(&attr, &all);
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+        for (;;) {
+            pollfd pfd = { fd, POLLIN, 0 };
+            int ready = poll(&pfd, 1, children.empty() ? -1 : 20);
+
+            if (ready > 0 && (pfd.revents & (POLLIN | POLLHUP))) {
+                ssize_t n = readRequest(fd, buffer);
+                if (n <= 0) break;  // App closed its end
+                if (size_t(n) > sizeof(quint32)) {
+                    quint32 id;
+                    memcpy(&id, buffer.data(), sizeof(id));
+                    buffer[size_t(n)] = '\0';
+
+                    argv.clear();
+                    for (char *p = buffer.data() + sizeof(id); p < buffer.data() + n; p += strlen(p) + 1) {
+                        argv.push_back(p);
+                    }
+                    argv.push_back(nullptr);
+
+                    pid_t pid = 0;
+                    qint64 start = nowNs();
+                    int err = posix_spawnp(&pid, argv[0], nullptr, &attr, argv.data(), environ);
+                    Result result = { id, qint32(pid), err ? Failed : Started, err, 0 };
+                    sendAll(fd, reinterpret_cast<const char *>(&result), sizeof(result));
+                    if (!err) children.push_back({ pid, id, start });
+                }
+            }
+
+            int status;
+            pid_t pid;
+            while (!children.empty() && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                for (size_t i = 0; i < children.size(); i++) {
+                    if (children[i].pid != pid) continue;
+                    Result result = { children[i].id, qint32(pid), Exited, status, nowNs() - children[i].startNs };
+                    sendAll(fd, reinterpret_cast<const char *>(&result), sizeof(result));
+                    children.erase(children.begin() + qsizetype(i));
+                    break;
+                }
+            }
+        }
+
+        posix_spawnattr_destroy(&attr);
+    }
+
+    QSocketNotifier *notifier = nullptr;
+    QByteArray received;            // Result bytes not yet handed out (stream socket)
+    QSet<quint32> outstanding;      // Requests sent whose command has not ended yet
+};
+Q_DECLARE_METATYPE(SpawnHelper::Result)
+
+#endif // Q_OS_UNIX
@@ -0,0 +1,610 @@
+#include "TelegraphCore.h"
+
+#include <QDateTime>
+#include <QSettings>
+
+void TelegraphCore::registerMetaTypes() {
+    qRegisterMetaType<LinkFrame>("LinkFrame");
+    qRegisterMetaType<QVector<LinkFrame>>("QVector<LinkFrame>");
+    qRegisterMetaType<CommandTablePtr>("CommandTablePtr");
+    qRegisterMetaType<ConnectionManager::Target>("ConnectionManager::Target");
+}
+
+TelegraphCore::TelegraphCore(const QString &configDir, QObject *parent)
+    : QObject(parent), configDir(configDir) {
+    // Start the background log writer before anything can log
+    logger.reset(new AsyncLogger(loadLogOptions()));
+
+    QSettings appSettings(configPath("TelgrafApp.conf"), QSettings::IniFormat);
+
+    // Frames are handed over in batches, see Link/BatchIntervalMs and Link/BatchMaxFrames
+    int batchIntervalMs = appSettings.value("Link/BatchIntervalMs", 16).toInt();
+    int batchMaxFrames = appSettings.value("Link/BatchMaxFrames", 32).toInt();
+
+    serialThread = new QThread(this);
+    worker = new SerialWorker();
+    worker->setBatching(batchIntervalMs, batchMaxFrames);
+    worker->setMetrics(&linkMetrics);
+    worker->setCapture(&capture);
+    worker->moveToThread(serialThread);
+
+    // Connect threading signals
+    connect(serialThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &TelegraphCore::operateOpenSerial, worker, &SerialWorker::openPort);
+    connect(this, &TelegraphCore::operateCloseSerial, worker, &SerialWorker::closePort);
+    connect(this, &TelegraphCore::operateWriteSerial, worker, &SerialWorker::writeData);
+
+    connect(worker, &SerialWorker::framesReceived, this, &TelegraphCore::processIncomingFrames);
+    connect(worker, &SerialWorker::connectionStatusChanged, this, &TelegraphCore::handleSerialConnectionStatus);
+    connect(worker, &SerialWorker::errorOccurred, this, &TelegraphCore::log);
+
+    serialThread->start();
+
+    btThread = new QThread(this);
+    btWorker = new BluetoothWorker();
+    btWorker->setBatching(batchIntervalMs, batchMaxFrames);
+    btWorker->setMetrics(&linkMetrics);
+    btWorker->setCapture(&capture);
+    btWorker->moveToThread(btThread);
+
+    connect(btThread, &QThread::finished, btWorker, &QObject::deleteLater);
+    connect(this, &TelegraphCore::operateOpenBluetooth, btWorker, &BluetoothWorker::openSocket);
+    connect(this, &TelegraphCore::operateCloseBluetooth, btWorker, &BluetoothWorker::closeSocket);
+    connect(this, &TelegraphCore::operateWriteBluetooth, btWorker, &BluetoothWorker::writeData);
+
+    connect(btWorker, &BluetoothWorker::framesReceived, this, &TelegraphCore::processIncomingFrames);
+    connect(btWorker, &BluetoothWorker::connectionStatusChanged, this, &TelegraphCore::handleBluetoothConnectionStatus);
+    connect(btWorker, &BluetoothWorker::errorOccurred, this, &TelegraphCore::log);
+
+    btThread->start();
+
+    // Offer COBS/CRC-16 framing on every new link, see Link/BinaryFraming
+    requestBinaryFraming = appSettings.value("Link/BinaryFraming", false).toBool();
+
+    // Sequence numbers, acks and resends for packets to the PIC, see Link/Reliable
+    reliable = new ReliableLink(ReliableLink::loadOptions(appSettings), this);
+    connect(reliable, &ReliableLink::writeRequested, this, &TelegraphCore::writePacket);
+    connect(reliable, &ReliableLink::packetFailed, this, [this](QByteArray body, int tries) {
+        log(QString("SYSTEM ERROR: PIC did not ack \"%1\" after %2 sends, dropped.")
+                .arg(QString::fromUtf8(body))
+                .arg(tries));
+    });
+    connect(reliable, &ReliableLink::setupFailed, this, [this](QVector<QByteArray> waiting, int offers) {
+        log(QString("SYSTEM: PIC did not answer arq_set after %1 tries, %2 waiting packets sent without reliable delivery.")
+                .arg(offers)
+                .arg(waiting.size()));
+        for (const QByteArray &body : waiting) writePacket(body);
+    });
+
+    // The PIC only sends its outbox while heartbeats arrive; 0 turns them off
+    heartbeat = new QTimer(this);
+    heartbeat->setInterval(appSettings.value("Link/HeartbeatMs", 2000).toInt());
+    connect(heartbeat, &QTimer::timeout, this, [this]() { writePacket("K,hb"); });
+
+    captureTimer = new QTimer(this);
+    captureTimer->setInterval(500);
+    connect(captureTimer, &QTimer::timeout, this, [this]() { capture.flush(); });
+
+    // Dropped links are re-opened with backoff, see Link/AutoReconnect and friends
+    connection = new ConnectionManager(ConnectionManager::loadOptions(appSettings), this);
+    connect(connection, &ConnectionManager::openRequested, this, [this](ConnectionManager::Target target) {
+        if (target.kind == ConnectionManager::Target::Usb) emit operateOpenSerial(target.port, target.baud);
+        else emit operateOpenBluetooth(target.address);
+    });
+    connect(connection, &ConnectionManager::reconnectScheduled, this, [this](int attempt, int delayMs) {
+        log(QString("SYSTEM: Link down, retrying %1 in %2 ms (attempt %3).")
+                .arg(connection->currentTarget().name())
+                .arg(delayMs)
+                .arg(attempt));
+        emit reconnecting(attempt, delayMs);
+    });
+    connect(connection, &ConnectionManager::linkRestored, this, [this](qint64 outageMs, int attempts) {
+        ConnectionManager::Stats stats = connection->currentStats();
+        log(QString("SYSTEM: Link restored after %1 ms and %2 attempts (%3 reconnects, %4 s down, %5 frames dropped in total).")
+                .arg(outageMs)
+                .arg(attempts)
+                .arg(stats.reconnects)
+                .arg(stats.downtimeMs / 1000)
+                .arg(stats.droppedFrames));
+    });
+
+    // Commands run through the spawn helper when available, see Commands/* settings
+    executor = new CommandExecutor(appSettings.value("Commands/MaxConcurrent", 8).toInt(),
+                                   appSettings.value("Commands/SpawnHelper", true).toBool(), this);
+    connect(executor, &CommandExecutor::commandFinished, this, [this](QString key, int code, bool crashed, qint64 ms) {
+        log(QString("SYSTEM: %1 %2 %3 after %4 ms")
+                .arg(key, crashed ? "killed by signal" : "exited with code")
+                .arg(code)
+                .arg(ms));
+    });
+    connect(executor, &CommandExecutor::commandStarted, this, [this](QString, qint64, qint64 latencyNs) {
+        linkMetrics.dispatchToSpawn.record(latencyNs);
+    });
+    connect(executor, &CommandExecutor::commandFailed, this, [this](QString key, QString error) {
+        log("SYSTEM ERROR: " + key + " could not be started (" + error + ")");
+    });
+}
+
+void TelegraphCore::start() {
+    start(StartOptions());
+}
+
+void TelegraphCore::start(const StartOptions &options) {
+    if (options.logFile) {
+        writeToFile("--- SESSION STARTED ---");
+    } else {
+        // Nothing was queued yet, so the writer never opened the file
+        logger->stop();
+        logger.reset();
+    }
+
+    // Prometheus scrape endpoint, see Metrics/Port and Metrics/Address
+    QSettings appSettings(configPath("TelgrafApp.conf"), QSettings::IniFormat);
+    int metricsPort = options.metricsServer ? appSettings.value("Metrics/Port", 0).toInt() : 0;
+    if (metricsPort > 0) {
+        QHostAddress address(appSettings.value("Metrics/Address", "127.0.0.1").toString());
+        metricsServer = new MetricsServer([this]() { return linkMetrics.prometheusText(isConnected()); }, this);
+        if (metricsServer->listen(address, quint16(metricsPort))) {
+            log(QString("SYSTEM: Metrics served on http://%1:%2/metrics").arg(address.toString()).arg(metricsPort));
+        } else {
+            log("SYSTEM ERROR: Metrics endpoint not started (" + metricsServer->errorString() + ")");
+        }
+    }
+
+    // Raw traffic capture for telgraf_replay, see Link/CaptureFile
+    QString capturePath = appSettings.value("Link/CaptureFile", "").toString();
+    if (options.capture && !capturePath.isEmpty()) startCapture(capturePath);
+
+    // Load commands from external JSON file and follow later edits
+    loadSystemCommands();
+
+    commandReloader = new CommandReloader(configPath("Command.json"), this);
+    connect(commandReloader, &CommandReloader::tableLoaded, this, &TelegraphCore::swapCommandTable);
+    connect(commandReloader, &CommandReloader::reloadFailed, this, [this](QString error) {
+        log("SYSTEM ERROR: Command.json reload rejected, keeping previous commands. " + error);
+    });
+}
+
+TelegraphCore::~TelegraphCore() {
+    serialThread->quit();
+    serialThread->wait();
+    btThread->quit();
+    btThread->wait();
+    capture.stop();
+
+    // Flush whatever is still queued before the core goes away
+    if (logger) {
+        writeToFile("--- SESSION ENDED ---");
+        logger->stop();
+    }
+}
+
+bool TelegraphCore::startCapture(const QString &path) {
+    QString error;
+    if (!capture.start(path, &error)) {
+        log("SYSTEM ERROR: Capture file " + path + " could not be opened (" + error + ")");
+        return false;
+    }
+    captureTimer->start();
+    log("SYSTEM: Capturing raw link traffic to " + path);
+    return true;
+}
+
+void TelegraphCore::stopCapture() {
+    if (!capture.isActive()) return;
+    captureTimer->stop();
+    capture.stop();
+    log("SYSTEM: Capture to " + capture.fileName() + " stopped.");
+}
+
+void TelegraphCore::openSerial(const QString &portName, int baud) {
+    ConnectionManager::Target target;
+    target.kind = ConnectionManager::Target::Usb;
+    target.port = portName;
+    target.baud = baud;
+    openLink(target);
+}
+
+void TelegraphCore::openBluetooth(const QString &address) {
+    ConnectionManager::Target target;
+    target.kind = ConnectionManager::Target::Bluetooth;
+    target.address = address;
+    openLink(target);
+}
+
+void TelegraphCore::openLink(const ConnectionManager::Target &target) {
+    if (target.kind == ConnectionManager::Target::Usb) log("USER: USB Connection request -> " + target.port);
+    else log("USER: BT Connection request -> " + target.address);
+    connection->open(target);
+}
+
+bool TelegraphCore::openSavedLink() {
+    QSettings settings(configPath("TelgrafApp.conf"), QSettings::IniFormat);
+    ConnectionManager::Target target = ConnectionManager::savedTarget(settings);
+    if (!target.isValid()) return false;
+    openLink(target);
+    return true;
+}
+
+void TelegraphCore::closeLink() {
+    bool wasReconnecting = connection->isReconnecting();
+    int dropped = connection->queuedCount();
+    connection->close();
+    if (dropped > 0) log("SYSTEM: " + QString::number(dropped) + " queued frames discarded.");
+
+    if (isBtConnected) emit operateCloseBluetooth();
+    else if (isUsbConnected) emit operateCloseSerial();
+    else if (wasReconnecting) {
+        log("USER: Reconnect cancelled.");
+        emit connectionChanged(false, "");
+    }
+}
+
+// Builds the "$T,payload*CS\r\n" text form of a "T,payload" body
+static QByteArray nmeaPacket(const QByteArray &body) {
+    quint8 checksum = 0;
+    for (char c : body) {
+        checksum ^= quint8(c);
+    }
+    return "$" + body + "*" + QByteArray::number(checksum, 16).toUpper() + "\r\n";
+}
+
+// Sends a packet to the PIC, or queues it while a supervised link is down
+bool TelegraphCore::sendPacket(const QString &type, const QString &payload) {
+    if (!isConnected() && !connection->isSupervising()) return false;
+
+    QByteArray body = (type + "," + payload).toUtf8();
+
+    if (isConnected()) {
+        // While arq_set is unanswered, wait behind the packets queued before
+        if (reliable->isActive() || reliable->isNegotiating()) reliable->send(body);
+        else writePacket(body);
+    } else {
+        connection->enqueue(body);
+        log("SYSTEM: Link down, frame queued (" + QString::number(connection->queuedCount()) + " waiting).");
+    }
+    return true;
+}
+
+// Frames a "T,payload" body as negotiated for this link and writes it.
+// Payloads too long for a binary frame still go out as text.
+void TelegraphCore::writePacket(const QByteArray &body) {
+    QByteArray packet;
+    if (binaryFraming && body.size() >= 2 && body[1] == ',') {
+        packet = BinaryFraming::encode(body[0], QByteArrayView(body).sliced(2));
+    }
+    if (packet.isEmpty()) packet = nmeaPacket(body);
+    linkMetrics.framesOut++;
+
+    if (isBtConnected) {
+        emit operateWriteBluetooth(packet);
+    } else {
+        emit operateWriteSerial(packet);
+    }
+}
+
+AsyncLogger::Options TelegraphCore::loadLogOptions() const {
+    QSettings settings(configPath("TelgrafApp.conf"), QSettings::IniFormat);
+
+    AsyncLogger::Options options;
+    // 0 would make the writer thread's timed wait spin
+    options.flushIntervalMs = qMax(1, settings.value("Log/FlushIntervalMs", options.flushIntervalMs).toInt());
+    options.flushBytes = settings.value("Log/FlushBytes", options.flushBytes).toInt();
+    options.maxFileBytes = settings.value("Log/MaxFileKB", options.maxFileBytes / 1024).toLongLong() * 1024;
+    options.rotateDaily = settings.value("Log/RotateDaily", options.rotateDaily).toBool();
+    options.keepFiles = settings.value("Log/KeepFiles", options.keepFiles).toInt();
+    return options;
+}
+
+void TelegraphCore::handleBluetoothConnectionStatus(bool connected, QString address) {
+    bool wasConnected = isBtConnected;
+    isBtConnected = connected;
+    if (connected) {
+        if (!connection->linkStatusChanged(true)) {
+            // Came up after the user cancelled the reconnect
+            emit operateCloseBluetooth();
+            return;
+        }
+        log("SYSTEM: Bluetooth connection successful -> " + address);
+        handleLinkUp("BLUETOOTH (" + address + ")");
+    } else {
+        handleLinkDown(wasConnected, "SYSTEM: Bluetooth connection disconnected.");
+    }
+}
+
+void TelegraphCore::handleSerialConnectionStatus(bool connected, QString portName) {
+    bool wasConnected = isUsbConnected;
+    isUsbConnected = connected;
+    if (connected) {
+        if (!connection->linkStatusChanged(true)) {
+            emit operateCloseSerial();
+            return;
+        }
+        log("SYSTEM: USB Serial connection successful -> " + portName);
+        handleLinkUp("USB (" + portName + ")");
+    } else {
+        handleLinkDown(wasConnected, "SYSTEM: USB connection closed or lost.");
+    }
+}
+
+// Remembers the working link and sends what was queued during the outage
+void TelegraphCore::handleLinkUp(const QString &linkInfo) {
+    frameLatency.reset();
+
+    QSettings settings(configPath("TelgrafApp.conf"), QSettings::IniFormat);
+    ConnectionManager::saveTarget(settings, connection->currentTarget());
+
+    // Text until the PIC answers bin_ack; old firmware just never does
+    binaryFraming = false;
+    if (requestBinaryFraming) writePacket("K,bin_set,1");
+    // Packets wait until the PIC answers arq_ack, or go out plain if it never does
+    if (reliable->isEnabled()) reliable->offer();
+    reliableAtLinkUp = reliable->currentStats();
+
+    // The PIC may have been reset or swapped while the link was down and
+    // number its outbox from 0 again. A message whose ack was lost with the
+    // old link is shown twice rather than a new one being dropped.
+    recentQueuedSeqs.clear();
+
+    // With reliable delivery the queued packets (unacked ones among them) wait
+    // in its backlog and go out numbered once arq_ack starts it
+    const QVector<QByteArray> queued = connection->takeQueued();
+    for (const QByteArray &packet : queued) {
+        if (reliable->isNegotiating()) reliable->send(packet);
+        else writePacket(packet);
+    }
+    if (!queued.isEmpty()) {
+        log("SYSTEM: " + QString::number(queued.size()) +
+            (reliable->isEnabled() ? " queued frames waiting for reliable delivery." : " queued frames sent."));
+    }
+
+    if (heartbeat->interval() > 0) {
+        writePacket("K,hb");
+        heartbeat->start();
+    }
+
+    emit connectionChanged(true, linkInfo);
+}
+
+void TelegraphCore::handleLinkDown(bool wasConnected, const QString &message) {
+    heartbeat->stop();
+    if (wasConnected) {
+        log(message);
+        logFrameLatency();
+        logReliableStats();
+    }
+
+    // Packets the PIC has not acked wait for the next link with the queued ones
+    const QVector<QByteArray> unacked = reliable->stop();
+    int kept = 0;
+    for (const QByteArray &body : unacked) {
+        if (connection->enqueue(body)) kept++;
+    }
+    if (!unacked.isEmpty()) {
+        log(QString("SYSTEM: %1 packets not acked by the PIC, %2 queued for the next link.").arg(unacked.size()).arg(kept));
+    }
+
+    connection->linkStatusChanged(false);
+    if (!connection->isReconnecting()) emit connectionChanged(false, "");
+}
+
+// Reports how long decoded frames waited between the worker read and the core
+void TelegraphCore::logFrameLatency() {
+    if (frameLatency.count == 0) return;
+    log(QString("SYSTEM: Frame latency avg %1 us, max %2 us over %3 frames.")
+            .arg(frameLatency.averageUs())
+            .arg(frameLatency.maxUs())
+            .arg(frameLatency.count));
+    frameLatency.reset();
+}
+
+// Reports throughput and resends of reliable delivery on the link that just went down
+void TelegraphCore::logReliableStats() {
+    ReliableLink::Stats stats = reliable->currentStats();
+    quint64 sends = (stats.packets - reliableAtLinkUp.packets) + (stats.retransmits - reliableAtLinkUp.retransmits);
+    if (sends == 0) return;
+    quint64 resent = stats.retransmits - reliableAtLinkUp.retransmits;
+    log(QString("SYSTEM: Reliable delivery: %1 packets acked, %2 of %3 sends were resends (%4 %), %5 dropped, %6 NAKs, %7 of %8 bytes useful.")
+            .arg(stats.acked - reliableAtLinkUp.acked)
+            .arg(resent)
+            .arg(sends)
+            .arg(100.0 * double(resent) / double(sends), 0, 'f', 1)
+            .arg(stats.failed - reliableAtLinkUp.failed)
+            .arg(stats.naks - reliableAtLinkUp.naks)
+            .arg(stats.goodBytes - reliableAtLinkUp.goodBytes)
+            .arg(stats.wireBytes - reliableAtLinkUp.wireBytes));
+}
+
+// Applies a batch of frames from a link worker with a single view update and log write
+void TelegraphCore::processIncomingFrames(const QVector<LinkFrame> &frames) {
+    beginBatch();
+    for (const LinkFrame &frame : frames) {
+        processIncomingData(frame);
+    }
+    endBatch();
+}
+
+// Handles a frame decoded by one of the link parsers
+void TelegraphCore::processIncomingData(const LinkFrame &frame) {
+    qint64 waitedNs = monotonicNs() - frame.receivedNs;
+    frameLatency.add(waitedNs);
+    linkMetrics.parseToDispatch.record(waitedNs);
+    linkMetrics.framesIn++;
+
+    if (frame.status == LinkFrame::BadChecksum) {
+        linkMetrics.checksumErrors++;
+        log("ERROR: Checksum Hatası! (" + QString(QChar::fromLatin1(frame.type)) + "," + frame.text() + ")");
+        // The PIC resends its outbox at once instead of waiting for the timeout
+        if (reliable->isActive()) writePacket("K,nak");
+        return;
+    }
+
+    if (frame.isAck() || frame.isNak()) {
+        bool ok = false;
+        int seq = frame.payloadView().toByteArray().toInt(&ok);
+        if (ok && frame.isAck()) reliable->acknowledge(seq);
+        else if (ok) reliable->negativeAcknowledge(seq);
+        return;
+    }
+
+    if (frame.isQueued()) {
+        LinkFrame inner;
+        if (unwrapQueuedFrame(frame, &inner)) dispatchFrame(inner);
+        return;
+    }
+    dispatchFrame(frame);
+}
+
+// Acks an outbox frame and extracts the message inside. Every copy is acked,
+// since the ack of an earlier one may have been lost; false for repeats.
+bool TelegraphCore::unwrapQueuedFrame(const LinkFrame &frame, LinkFrame *inner) {
+    QByteArrayView payload = frame.payloadView();
+    qsizetype comma = payload.indexOf(',');
+    bool ok = false;
+    int seq = comma > 0 ? payload.first(comma).toByteArray().toInt(&ok) : 0;
+    if (!ok || payload.size() < comma + 3 || payload[comma + 2] != ',') {
+        log("ERROR: Malformed outbox frame (" + frame.text() + ")");
+        return false;
+    }
+
+    writePacket("K,ack," + QByteArray::number(seq));
+    if (recentQueuedSeqs.contains(seq)) {
+        log(QString("SYSTEM: Outbox message %1 received again, ignored.").arg(seq));
+        return false;
+    }
+    // The PIC holds three messages, so a short history catches every resend;
+    // it is cleared on each link-up (see handleLinkUp)
+    recentQueuedSeqs.append(seq);
+    if (recentQueuedSeqs.size() > 8) recentQueuedSeqs.removeFirst();
+
+    *inner = frame;
+    inner->type = payload[comma + 1];
+    inner->length = quint8(payload.size() - comma - 3);
+    std::memcpy(inner->payload, frame.payload + comma + 3, inner->length);
+    return true;
+}
+
+// Acts on a message, command or status frame
+void TelegraphCore::dispatchFrame(const LinkFrame &frame) {
+    if (frame.isCommand() && requestBinaryFraming && CommandTable::normalizedKey(frame.payloadView()) == "BIN_ACK") {
+        binaryFraming = true;
+        log("SYSTEM: PIC accepted binary framing.");
+        return;
+    }
+
+    if (frame.isCommand() && reliable->isEnabled() && CommandTable::normalizedKey(frame.payloadView()) == "ARQ_ACK") {
+        // The answer to a repeated offer must not renumber packets in flight
+        if (!reliable->isActive()) {
+            reliable->start();
+            log("SYSTEM: PIC accepted reliable delivery.");
+        }
+        return;
+    }
+
+    if (frame.isCommand()) {
+        log("INCOMING COMMAND: " + frame.text());
+        handleSystemCommand(frame.payloadView());
+    }
+    else if (frame.isStatus()) {
+        log("PIC STATUS: " + frame.text());
+    }
+    else if (frame.isMessage()) {
+        QString msgContent = frame.text();
+        pendingMessages.append({batchDate, batchTime, msgContent});
+        log("INCOMING MESSAGE: " + msgContent);
+    }
+}
+
+// Executes system commands based on received data
+void TelegraphCore::handleSystemCommand(QByteArrayView payload) {
+    qint64 dispatchedNs = monotonicNs();
+
+    // Hold our own reference so a reload swapping the table can't pull it away mid-dispatch
+    CommandTablePtr table = std::atomic_load(&commandTable);
+    int index = table->find(payload);
+
+    if (index >= 0) {
+        const CommandSpec &cmd = table->spec(index);
+
+        if (table->tryAcquire(index, QDateTime::currentMSecsSinceEpoch())) {
+            if (executor->execute(cmd, dispatchedNs)) {
+                log("SYSTEM ACTION: " + cmd.systemCommand);
+            } else {
+                linkMetrics.busyRejections++;
+                log(QString("SYSTEM: %1 rejected, %2 commands already running")
+                        .arg(QString::fromUtf8(cmd.key))
+                        .arg(executor->runningCount()));
+            }
+        } else {
+            linkMetrics.cooldownRejections++;
+            log("SYSTEM: " + QString::fromUtf8(cmd.key) + " (Bekleme Süresinde)");
+        }
+    } else {
+        linkMetrics.unknownCommands++;
+        log("UNKNOWN COMMAND: " + QString::fromUtf8(CommandTable::normalizedKey(payload)));
+    }
+}
+
+void TelegraphCore::log(const QString &text) {
+    beginBatch();
+    pendingLines.append({batchDate, batchTime, text});
+
+    if (!pendingLogFile.isEmpty()) pendingLogFile.append('\n');
+    pendingLogFile.append(("[" + batchDate + " " + batchTime + "] " + text).toUtf8());
+    endBatch();
+}
+
+// Queues a line for telegraph.log; the actual write happens on the logger thread
+void TelegraphCore::writeToFile(const QString &text) {
+    if (logger) logger->log(text.toUtf8());
+}
+
+// While a batch is open, lines are only collected and share one timestamp
+void TelegraphCore::beginBatch() {
+    if (batchDepth++ == 0) {
+        QDateTime now = QDateTime::currentDateTime();
+        batchDate = now.toString("dd.MM.yyyy");
+        batchTime = now.toString("HH:mm:ss");
+    }
+}
+
+void TelegraphCore::endBatch() {
+    if (--batchDepth == 0) flushBatch();
+}
+
+// Hands the collected lines to the listeners and the log file in one go
+void TelegraphCore::flushBatch() {
+    if (!pendingLogFile.isEmpty()) {
+        if (logger) logger->log(pendingLogFile);
+        pendingLogFile.clear();
+    }
+    if (!pendingMessages.isEmpty()) {
+        QVector<Line> messages;
+        messages.swap(pendingMessages);
+        emit messagesReceived(messages);
+    }
+    if (!pendingLines.isEmpty()) {
+        QVector<Line> lines;
+        lines.swap(pendingLines);
+        emit logLines(lines);
+    }
+}
+
+void TelegraphCore::loadSystemCommands() {
+    QString error;
+    CommandTablePtr table = CommandReloader::load(configPath("Command.json"), &error);
+    if (!table) {
+        log("SYSTEM ERROR: " + error);
+        return;
+    }
+
+    std::atomic_store(&commandTable, table);
+    log("SYSTEM: " + QString::number(table->size()) + " commands loaded from config (" + executor->engineName() + ").");
+}
+
+// Installs a table rebuilt by the reloader, keeping cooldowns of unchanged commands
+void TelegraphCore::swapCommandTable(CommandTablePtr table) {
+    table->inheritCooldowns(*std::atomic_load(&commandTable));
+    std::atomic_store(&commandTable, table);
+    log("SYSTEM: Command.json reloaded, " + QString::number(table->size()) + " commands active.");
+}
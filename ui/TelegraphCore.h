@@ -0,0 +1,176 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+
+#include "SerialWorker.h"
+#include "BluetoothWorker.h"
+#include "AsyncLogger.h"
+#include "CommandExecutor.h"
+#include "CommandReloader.h"
+#include "ConnectionManager.h"
+#include "ReliableLink.h"
+#include "MetricsServer.h"
+
+// Everything the station does without a screen: the link workers and their
+// threads, frame handling, `$K` command dispatch and the log file.
+// TelegraphWindow and the headless telgrafd daemon both drive one of these;
+// the window only renders what comes out of logLines/messagesReceived.
+class TelegraphCore : public QObject {
+    Q_OBJECT
+public:
+    // One log line or chat message, stamped when it was produced
+    struct Line {
+        QString date;   // "dd.MM.yyyy"
+        QString time;   // "HH:mm:ss"
+        QString text;
+    };
+
+    // `configDir` holds TelgrafApp.conf, Command.json and friends
+    explicit TelegraphCore(const QString &configDir, QObject *parent = nullptr);
+    ~TelegraphCore();
+
+    // Registers the types passed through queued connections; call once from main()
+    static void registerMetaTypes();
+
+    // What start() brings up besides the command table. telgraf_replay turns
+    // all of them off, so a replay never touches the station's telegraph.log,
+    // its capture file (possibly the one being replayed) or its metrics port.
+    struct StartOptions {
+        bool logFile = true;        // telegraph.log, see Log/*
+        bool capture = true;        // Link/CaptureFile
+        bool metricsServer = true;  // Metrics/Port
+    };
+
+    // Loads Command.json and starts the session; call once the listeners are connected
+    void start();
+    void start(const StartOptions &options);
+
+    // Opening a link also puts it under supervision: if it drops it is
+    // re-opened with backoff until closeLink() is called
+    void openSerial(const QString &portName, int baud);
+    void openBluetooth(const QString &address);
+    void openLink(const ConnectionManager::Target &target);
+    void closeLink();
+
+    // Re-opens the link last saved in TelgrafApp.conf; false if there is none
+    bool openSavedLink();
+
+    bool isConnected() const { return isBtConnected || isUsbConnected; }
+    bool isReconnecting() const { return connection->isReconnecting(); }
+    ConnectionManager::Stats connectionStats() const { return connection->currentStats(); }
+
+    // Reliable delivery to the PIC, see Link/Reliable
+    bool isReliableEnabled() const { return reliable->isEnabled(); }
+    bool isReliableActive() const { return reliable->isActive(); }
+    ReliableLink::Stats reliableStats() const { return reliable->currentStats(); }
+    int reliablePendingCount() const { return reliable->pendingCount(); }
+
+    // Counters and latency histograms of the link, see LinkMetrics
+    const LinkMetrics &metrics() const { return linkMetrics; }
+
+    // Raw capture of every byte read from and written to the link, see
+    // Link/CaptureFile; the file is replaced
+    bool startCapture(const QString &path);
+    void stopCapture();
+
+    // Handles frames that did not come from a link worker (telgraf_replay)
+    void replayFrames(const QVector<LinkFrame> &frames) { processIncomingFrames(frames); }
+
+    // Looks up, rate limits and counts commands without starting them
+    void setCommandDryRun(bool on) { executor->setDryRun(on); }
+
+    // Frames and writes a packet with checksum. While a supervised link is
+    // down the packet is queued instead. Returns false if no link is open.
+    bool sendPacket(const QString &type, const QString &payload);
+
+    // Timestamps a line, writes it to the log file and reports it through logLines
+    void log(const QString &text);
+
+    // Queues a raw line for telegraph.log only (session markers)
+    void writeToFile(const QString &text);
+
+    QString configPath(const QString &fileName) const { return configDir + "/" + fileName; }
+
+signals:
+    // Lines logged since the last emission; a whole frame batch arrives at once
+    void logLines(QVector<TelegraphCore::Line> lines);
+    void messagesReceived(QVector<TelegraphCore::Line> messages);
+    void connectionChanged(bool connected, QString linkInfo);
+    void reconnecting(int attempt, int delayMs);
+
+    void operateOpenSerial(QString name, int baud);
+    void operateCloseSerial();
+    void operateWriteSerial(QByteArray data);
+    void operateOpenBluetooth(QString address);
+    void operateCloseBluetooth();
+    void operateWriteBluetooth(QByteArray data);
+
+private:
+    AsyncLogger::Options loadLogOptions() const;
+
+    void handleSerialConnectionStatus(bool connected, QString portName);
+    void handleBluetoothConnectionStatus(bool connected, QString address);
+    void logFrameLatency();
+    void logReliableStats();
+    void handleLinkUp(const QString &linkInfo);
+    void handleLinkDown(bool wasConnected, const QString &message);
+    void writePacket(const QByteArray &body);
+
+    void processIncomingFrames(const QVector<LinkFrame> &frames);
+    void processIncomingData(const LinkFrame &frame);
+    bool unwrapQueuedFrame(const LinkFrame &frame, LinkFrame *inner);
+    void dispatchFrame(const LinkFrame &frame);
+    void handleSystemCommand(QByteArrayView payload);
+
+    void loadSystemCommands();
+    void swapCommandTable(CommandTablePtr table);
+
+    void beginBatch();
+    void endBatch();
+    void flushBatch();
+
+    QString configDir;
+
+    std::unique_ptr<AsyncLogger> logger;
+
+    QThread *serialThread;
+    SerialWorker *worker;
+    QThread *btThread;
+    BluetoothWorker *btWorker;
+
+    bool isBtConnected = false;
+    bool isUsbConnected = false;
+    ConnectionManager *connection;
+
+    bool requestBinaryFraming = false;  // Link/BinaryFraming
+    bool binaryFraming = false;         // PIC acknowledged bin_set on this link
+    ReliableLink *reliable;
+    ReliableLink::Stats reliableAtLinkUp;
+
+    LatencyCounter frameLatency;
+    LinkMetrics linkMetrics;
+    MetricsServer *metricsServer = nullptr;    // Metrics/Port, off by default
+    TrafficCapture capture;
+    QTimer *captureTimer;                       // Moves captured bytes to the file
+
+    // Keeps the PIC outbox sending while the link is up, see Link/HeartbeatMs
+    QTimer *heartbeat;
+    QVector<int> recentQueuedSeqs;      // Outbox messages shown on this link, newest last
+
+    CommandTablePtr commandTable = std::make_shared<CommandTable>();
+    CommandReloader *commandReloader = nullptr;
+    CommandExecutor *executor;
+
+    int batchDepth = 0;
+    QString batchDate;
+    QString batchTime;
+    QVector<Line> pendingLines;
+    QVector<Line> pendingMessages;
+    QByteArray pendingLogFile;
+};
+Q_DECLARE_METATYPE(TelegraphCore::Line)
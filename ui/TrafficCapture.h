@@ -0,0 +1,172 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "LinkMetrics.h"
+
+// Raw capture of the link traffic, see Link/CaptureFile and telgraf_replay.
+// Every chunk a link worker reads and every packet it writes is appended with
+// its monotonic time, so a session can later be fed through the parser and
+// dispatcher again exactly as it arrived. File layout, little endian:
+//   header: "TGCAPTR\0", quint32 version, qint64 wall clock at start (ms since epoch)
+//   record: quint8 direction, quint32 us since the previous record,
+//           quint16 length, `length` raw bytes
+// The workers only append to a memory buffer; the core's thread moves it to
+// the file (flush), so a slow disk never holds up a read.
+class TrafficCapture {
+public:
+    enum Direction : quint8 {
+        FromPic = 0,    // Read off the link
+        ToPic = 1       // Written to the link
+    };
+
+    static constexpr char Magic[8] = {'T', 'G', 'C', 'A', 'P', 'T', 'R', '\0'};
+    static constexpr quint32 Version = 1;
+    static constexpr int HeaderSize = 20;
+    static constexpr int RecordHeaderSize = 7;
+
+    struct Record {
+        Direction direction = FromPic;
+        qint64 timeNs = 0;          // Since the start of the capture
+        QByteArrayView data;
+    };
+
+    // Walks a capture held in memory, e.g. mapped with QFile::map
+    class Reader {
+    public:
+        explicit Reader(QByteArrayView capture) : capture(capture) {
+            valid = capture.size() >= HeaderSize && memcmp(capture.data(), Magic, sizeof(Magic)) == 0
+                    && qFromLittleEndian<quint32>(capture.data() + 8) == Version;
+            if (valid) startedMs = qFromLittleEndian<qint64>(capture.data() + 12);
+            rewind();
+        }
+
+        bool isValid() const { return valid; }
+        qint64 startedMsSinceEpoch() const { return startedMs; }
+
+        // True if the file ends inside a record (capture cut short)
+        bool isTruncated() const { return truncated; }
+
+        void rewind() {
+            offset = HeaderSize;
+            timeNs = 0;
+            truncated = false;
+        }
+
+        // Next record; false at the end of the capture
+        bool next(Record *record) {
+            if (!valid || offset >= capture.size()) return false;
+            if (capture.size() - offset < RecordHeaderSize) {
+                truncated = true;
+                return false;
+            }
+            const char *p = capture.data() + offset;
+            quint16 length = qFromLittleEndian<quint16>(p + 5);
+            if (capture.size() - offset - RecordHeaderSize < length) {
+                truncated = true;
+                return false;
+            }
+            timeNs += qint64(qFromLittleEndian<quint32>(p + 1)) * 1000;
+            record->direction = Direction(quint8(p[0]));
+            record->timeNs = timeNs;
+            record->data = capture.sliced(offset + RecordHeaderSize, length);
+            offset += RecordHeaderSize + length;
+            return true;
+        }
+
+    private:
+        QByteArrayView capture;
+        qsizetype offset = HeaderSize;
+        qint64 timeNs = 0;
+        qint64 startedMs = 0;
+        bool valid = false;
+        bool truncated = false;
+    };
+
+    // Core thread: starts a new capture file, replacing an older one at `path`
+    bool start(const QString &path, QString *error) {
+        stop();
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            *error = file.errorString();
+            return false;
+        }
+
+        char header[HeaderSize];
+        memcpy(header, Magic, sizeof(Magic));
+        qToLittleEndian<quint32>(Version, header + 8);
+        qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 12);
+        file.write(header, HeaderSize);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.clear();
+        lastNs = monotonicNs();
+        active.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Core thread: writes what is left and closes the file. Taking the lock
+    // waits out a record() that saw the capture still active.
+    void stop() {
+        QByteArray pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!active.exchange(false)) return;
+            pending.swap(buffer);
+        }
+        if (!pending.isEmpty()) file.write(pending);
+        file.close();
+    }
+
+    bool isActive() const { return active.load(std::memory_order_relaxed); }
+    QString fileName() const { return file.fileName(); }
+
+    // Any thread: appends a chunk stamped with monotonicNs()
+    void record(Direction direction, QByteArrayView data, qint64 stampNs) {
+        if (!active.load(std::memory_order_acquire) || data.isEmpty()) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!active.load(std::memory_order_relaxed)) return;    // stop() got in first
+        while (!data.isEmpty()) {
+            QByteArrayView part = data.first(qMin<qsizetype>(data.size(), 0xFFFF));
+            // Whole microseconds only, so the times read back do not drift
+            qint64 deltaUs = qBound<qint64>(0, (stampNs - lastNs) / 1000, 0xFFFFFFFF);
+            lastNs += deltaUs * 1000;
+
+            char header[RecordHeaderSize];
+            header[0] = char(direction);
+            qToLittleEndian<quint32>(quint32(deltaUs), header + 1);
+            qToLittleEndian<quint16>(quint16(part.size()), header + 5);
+            buffer.append(header, RecordHeaderSize);
+            buffer.append(part.data(), part.size());
+            data = data.sliced(part.size());
+        }
+    }
+
+    // Core thread: moves the buffered records to the file
+    void flush() {
+        QByteArray pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.swap(buffer);
+        }
+        if (pending.isEmpty() || !file.isOpen()) return;
+        file.write(pending);
+        file.flush();
+    }
+
+private:
+    QFile file;
+    std::atomic<bool> active{false};
+    std::mutex mutex;
+    QByteArray buffer;
+    qint64 lastNs = 0;
+};
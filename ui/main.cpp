@@ -17,14 +17,9 @@
 #include <QScrollBar>
 #include <QMessageBox>
 #include <QRandomGenerator>
-#include <QThread>
-#include <QSerialPort>
 #include <QSerialPortInfo>
 #include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
-#include <QtBluetooth/QBluetoothSocket>
 #include <QtBluetooth/QBluetoothDeviceInfo>
-#include <QtBluetooth/QBluetoothUuid>
-#include <QtBluetooth/QBluetoothAddress>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -32,78 +27,12 @@
 #include <QDir>
 #include <QCoreApplication>
 #include <QKeyEvent>
+#include <QStatusBar>
+#include <QTimer>
+#include <QFontDatabase>
 
-// Struct to hold configuration for system commands
-struct CommandConfig {
-    QString systemCommand;  // The actual OS command to execute
-    qint64 lastRunTime;     // Timestamp of the last execution
-    int offsetMs;           // Debounce/Cooldown time in milliseconds
-};
-
-// Worker class to handle Serial Port operations in a separate thread
-class SerialWorker : public QObject {
-    Q_OBJECT
-public:
-    QSerialPort *serialPort;
-
-    SerialWorker() {
-        serialPort = new QSerialPort();
-    }
-    ~SerialWorker() {
-        if(serialPort->isOpen()) serialPort->close();
-        delete serialPort;
-    }
-
-public slots:
-    // Opens the serial port with specified parameters
-    void openPort(QString name, int baud) {
-        serialPort->setPortName(name);
-        serialPort->setBaudRate(baud);
-        serialPort->setDataBits(QSerialPort::Data8);
-        serialPort->setParity(QSerialPort::NoParity);
-        serialPort->setStopBits(QSerialPort::OneStop);
-        
-        if(serialPort->open(QIODevice::ReadWrite)) {
-            emit connectionStatusChanged(true, name);
-            connect(serialPort, &QSerialPort::readyRead, this, &SerialWorker::readData);
-        } else {
-            emit connectionStatusChanged(false, "");
-            emit errorOccurred("SERIAL PORT ERROR: " + serialPort->errorString());
-        }
-    }
-
-    // Closes the serial port
-    void closePort() {
-        if(serialPort->isOpen()) {
-            serialPort->close();
-            disconnect(serialPort, &QSerialPort::readyRead, this, &SerialWorker::readData);
-        }
-        emit connectionStatusChanged(false, "");
-    }
-
-    // Writes data to the open serial port
-    void writeData(QString data) {
-        if(serialPort->isOpen()) {
-            serialPort->write(data.toUtf8());
-        }
-    }
-
-    // Reads incoming data line by line
-    void readData() {
-        while(serialPort->canReadLine()) {
-            QByteArray data = serialPort->readLine().trimmed();
-            QString line = QString::fromUtf8(data);
-            if(!line.isEmpty()) {
-                emit messageReceived(line);
-            }
-        }
-    }
-
-signals:
-    void messageReceived(QString message);
-    void connectionStatusChanged(bool connected, QString portName);
-    void errorOccurred(QString error);
-};
+#include "TelegraphCore.h"
+#include "MessageViews.h"
 
 // Main Application Window
 class TelegraphWindow : public QMainWindow {
@@ -111,6 +40,9 @@ class TelegraphWindow : public QMainWindow {
 
 public:
     TelegraphWindow(QWidget *parent = nullptr) : QMainWindow(parent) {
+        // Links, command dispatch and the log file live in the shared core
+        core = new TelegraphCore(QCoreApplication::applicationDirPath() + "/.config", this);
+
         setWindowTitle("PIC CONTROL STATION V3");
         resize(1200, 750);
 
@@ -188,6 +120,14 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
         settingsLayout->addWidget(customCmdInput);
         settingsLayout->addWidget(sendCmdButton);
 
+        // Link counters and latency percentiles, refreshed every second
+        metricsLabel = new QLabel();
+        metricsLabel->setObjectName("metricsLabel");
+        metricsLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        settingsLayout->addSpacing(20);
+        settingsLayout->addWidget(new QLabel("LINK METRICS"));
+        settingsLayout->addWidget(metricsLabel);
+
         settingsLayout->addStretch();
         settingsLayout->addWidget(statusLabel);
         settingsLayout->addWidget(connectButton);
@@ -203,12 +143,21 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
         chatLayout->addWidget(chatTitle);
         chatLayout->addSpacing(10);
 
-        chatDisplay = new QTextEdit();
-        chatDisplay->setReadOnly(true);
+        // Chat and log keep only the newest rows, see UI/ChatRetention and UI/LogRetention
+        QSettings appSettings(QCoreApplication::applicationDirPath() + "/.config/TelgrafApp.conf", QSettings::IniFormat);
+        chatModel = new MessageRingModel(appSettings.value("UI/ChatRetention", 1000).toInt(), this);
+        logModel = new MessageRingModel(appSettings.value("UI/LogRetention", 5000).toInt(), this);
+
+        chatDisplay = new AutoScrollListView();
+        chatDelegate = new ChatDelegate(chatDisplay);
+        chatDisplay->setItemDelegate(chatDelegate);
+        chatDisplay->setModel(chatModel);
+        chatDisplay->setSelectionMode(QAbstractItemView::NoSelection);
         chatDisplay->setFocusPolicy(Qt::NoFocus);
 
         messageInput = new QLineEdit();
         messageInput->setPlaceholderText("Type a message...");
+        messageInput->setMaxLength(24); // Longest message the PIC can queue and display
         messageInput->setFixedHeight(45);
 
         chatLayout->addWidget(chatDisplay);
@@ -227,8 +176,9 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
         logLayout->addWidget(logTitle);
         logLayout->addSpacing(10);
 
-        logDisplay = new QTextEdit();
-        logDisplay->setReadOnly(true);
+        logDisplay = new AutoScrollListView();
+        logDisplay->setModel(logModel);
+        logDisplay->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
         QPushButton *clearButton = new QPushButton("CLEAR LOGS");
         clearButton->setCursor(Qt::PointingHandCursor);
@@ -243,28 +193,14 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
         mainLayout->addWidget(chatGroup, 1);
         mainLayout->addWidget(logGroup);
 
-        // Initialize Bluetooth and Serial components
-        btSocket = new QBluetoothSocket(QBluetoothServiceInfo::RfcommProtocol, this);
+        // Initialize Bluetooth discovery
         discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
 
-        serialThread = new QThread(this);
-        worker = new SerialWorker();
-        worker->moveToThread(serialThread);
-
-        // Connect threading signals
-        connect(serialThread, &QThread::finished, worker, &QObject::deleteLater);
-        connect(this, &TelegraphWindow::operateOpenSerial, worker, &SerialWorker::openPort);
-        connect(this, &TelegraphWindow::operateCloseSerial, worker, &SerialWorker::closePort);
-        connect(this, &TelegraphWindow::operateWriteSerial, worker, &SerialWorker::writeData);
-        
-        connect(worker, &SerialWorker::messageReceived, this, &TelegraphWindow::handleSerialMessage);
-        connect(worker, &SerialWorker::connectionStatusChanged, this, &TelegraphWindow::handleSerialConnectionStatus);
-        connect(worker, &SerialWorker::errorOccurred, this, &TelegraphWindow::appendLog);
-
-        serialThread->start();
-
-        // Load commands from external JSON file
-        loadSystemCommands(); 
+        // Core output is rendered by the chat/log views and the status panel
+        connect(core, &TelegraphCore::logLines, this, &TelegraphWindow::showLogLines);
+        connect(core, &TelegraphCore::messagesReceived, this, &TelegraphWindow::showIncomingMessages);
+        connect(core, &TelegraphCore::connectionChanged, this, &TelegraphWindow::updateUIConnectedState);
+        connect(core, &TelegraphCore::reconnecting, this, &TelegraphWindow::updateUIReconnectingState);
 
         // Connect UI Signals
         connect(connectionTypeSelect, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &TelegraphWindow::onConnectionTypeChanged);
@@ -279,22 +215,31 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
             appendLog("SYSTEM: Scan complete.");
         });
 
-        // Bluetooth Socket Signals
-        connect(btSocket, &QBluetoothSocket::connected, this, &TelegraphWindow::btSocketConnected);
-        connect(btSocket, &QBluetoothSocket::disconnected, this, &TelegraphWindow::btSocketDisconnected);
-        connect(btSocket, &QBluetoothSocket::readyRead, this, &TelegraphWindow::readBtSocketData);
-        
         // Input Handling
         connect(messageInput, &QLineEdit::returnPressed, this, &TelegraphWindow::sendMessage);
         connect(sendCmdButton, &QPushButton::clicked, this, &TelegraphWindow::sendCustomCommand);
         connect(themeButton, &QPushButton::clicked, this, &TelegraphWindow::toggleTheme);
         connect(clearButton, &QPushButton::clicked, this, [this](){
-            logDisplay->clear();
-            chatDisplay->clear();
+            logModel->clear();
+            chatModel->clear();
             writeToFile("--- LOGS CLEARED ---");
         });
 
-        writeToFile("--- SESSION STARTED ---");
+        // Reliable delivery figures in the status bar, refreshed every second
+        if (core->isReliableEnabled()) {
+            reliableLabel = new QLabel("RELIABLE: WAITING FOR LINK");
+            statusBar()->addPermanentWidget(reliableLabel);
+            QTimer *reliableTimer = new QTimer(this);
+            connect(reliableTimer, &QTimer::timeout, this, &TelegraphWindow::updateReliableStatus);
+            reliableTimer->start(1000);
+        }
+
+        QTimer *metricsTimer = new QTimer(this);
+        connect(metricsTimer, &QTimer::timeout, this, &TelegraphWindow::updateMetricsPanel);
+        metricsTimer->start(1000);
+
+        core->start();
+        updateMetricsPanel();
         
         qApp->installEventFilter(this); 
 
@@ -305,9 +250,6 @@ statusLabel = new QLabel("STATUS: DISCONNECTED");
 
     ~TelegraphWindow() {
         saveSettings();
-        
-        serialThread->quit();
-        serialThread->wait();
     }
 
 protected:
@@ -333,11 +275,13 @@ protected:
                     hasSelection = le->hasSelectedText();
                 } else if (QTextEdit *te = qobject_cast<QTextEdit*>(currentFocus)) {
                     hasSelection = te->textCursor().hasSelection();
+                } else if (QAbstractItemView *view = qobject_cast<QAbstractItemView*>(currentFocus)) {
+                    hasSelection = view->selectionModel() && view->selectionModel()->hasSelection();
                 }
 
                 if (!hasSelection) {
-                    logDisplay->clear();
-                    chatDisplay->clear();
+                    logModel->clear();
+                    chatModel->clear();
                     writeToFile("--- LOGS CLEARED (Shortcut) ---");
                     appendLog("SYSTEM: Logs cleared via shortcut.");
                     return true;
@@ -359,11 +303,8 @@ protected:
     }
 
 private:
-    QBluetoothSocket *btSocket;
     QBluetoothDeviceDiscoveryAgent *discoveryAgent;
-    
-    QThread *serialThread;
-    SerialWorker *worker;
+    TelegraphCore *core;
 
     QComboBox *connectionTypeSelect;
     QComboBox *portSelect;
@@ -373,19 +314,24 @@ private:
     QPushButton *themeButton;
     QPushButton *sendCmdButton;
     QLabel *statusLabel;
-    QTextEdit *chatDisplay;
+    QLabel *reliableLabel = nullptr;
+    ReliableLink::Stats lastReliableStats;
+    QLabel *metricsLabel;
+    quint64 lastFramesIn = 0;
+    quint64 lastFramesOut = 0;
+    AutoScrollListView *chatDisplay;
+    MessageRingModel *chatModel;
+    ChatDelegate *chatDelegate;
     QLineEdit *messageInput;
     QLineEdit *customCmdInput;
-    QTextEdit *logDisplay;
+    AutoScrollListView *logDisplay;
+    MessageRingModel *logModel;
     QString keyFocusCmd;
     QString keyFocusMsg;
     int keyClearFocus;
     
-    QMap<QString, CommandConfig> commandMap;
     QString lastLogDate;
     bool isDarkTheme = true;
-    bool isBtConnected = false;
-    bool isUsbConnected = false;
 
     // Setups the CSS stylesheet for the application (Light/Dark mode)
     void setupStyles(bool dark) {
@@ -459,6 +405,11 @@ private:
 
         QString savedPort = settings.value("Connection/LastPort", "").toString();
         int portIndex = portSelect->findText(savedPort);
+        if (portIndex == -1 && connType == 1 && !savedPort.isEmpty()) {
+            // Not a serial port the system lists, e.g. the pty of telgraf_vpic
+            portSelect->addItem(savedPort);
+            portIndex = portSelect->count() - 1;
+        }
         if (portIndex != -1) {
             portSelect->setCurrentIndex(portIndex);
         }
@@ -475,6 +426,7 @@ private:
         settings.setValue("Connection/Type", connectionTypeSelect->currentIndex());
         settings.setValue("Connection/Baud", baudSelect->currentText());
         settings.setValue("Connection/LastPort", portSelect->currentText());
+        settings.setValue("Connection/LastAddress", portSelect->currentData().toString());
 
         settings.sync();
     }
@@ -483,6 +435,8 @@ private:
         isDarkTheme = !isDarkTheme;
         themeButton->setText(isDarkTheme ? "SWITCH TO LIGHT MODE" : "SWITCH TO DARK MODE");
         setupStyles(isDarkTheme);
+        chatDelegate->setDarkTheme(isDarkTheme);
+        chatDisplay->viewport()->update();
         appendLog("USER: Theme changed.");
     }
 
@@ -519,26 +473,6 @@ private:
         portSelect->addItem(label, QVariant::fromValue(device.address().toString()));
     }
 
-    void btSocketConnected() {
-        isBtConnected = true;
-        updateUIConnectedState(true, "BLUETOOTH");
-        appendLog("SYSTEM: Bluetooth connection successful.");
-    }
-
-    void btSocketDisconnected() {
-        isBtConnected = false;
-        updateUIConnectedState(false, "");
-        appendLog("SYSTEM: Bluetooth connection disconnected.");
-    }
-
-    void readBtSocketData() {
-        while (btSocket->canReadLine()) {
-            QByteArray data = btSocket->readLine().trimmed();
-            QString line = QString::fromUtf8(data);
-            processIncomingData(line);
-        }
-    }
-
     void refreshUsbPorts() {
         portSelect->clear();
         const auto infos = QSerialPortInfo::availablePorts();
@@ -547,29 +481,10 @@ private:
         }
     }
 
-    void handleSerialConnectionStatus(bool connected, QString portName) {
-        isUsbConnected = connected;
-        if(connected) {
-            updateUIConnectedState(true, "USB (" + portName + ")");
-            appendLog("SYSTEM: USB Serial connection successful -> " + portName);
-        } else {
-            updateUIConnectedState(false, "");
-            appendLog("SYSTEM: USB connection closed or lost.");
-        }
-    }
-
-    void handleSerialMessage(QString line) {
-        processIncomingData(line);
-    }
-
     // Handles the Connect/Disconnect button logic
     void toggleConnection() {
-        if (isBtConnected) {
-            btSocket->disconnectFromService();
-            return;
-        }
-        if (isUsbConnected) {
-            emit operateCloseSerial();
+        if (core->isConnected() || core->isReconnecting()) {
+            core->closeLink();
             return;
         }
 
@@ -581,11 +496,9 @@ private:
                 QMessageBox::warning(this, "Error", "Please select a Bluetooth device.");
                 return;
             }
-            QBluetoothAddress address(addressStr);
-            btSocket->connectToService(address, QBluetoothUuid::ServiceClassUuid::SerialPort);
+            core->openBluetooth(addressStr);
             connectButton->setText("CONNECTING...");
             connectButton->setEnabled(false);
-            appendLog("USER: BT Connection request -> " + addressStr);
         } 
         else { // USB
             QString portName = portSelect->currentText();
@@ -594,10 +507,9 @@ private:
                 return;
             }
             int baud = baudSelect->currentText().toInt();
-            emit operateOpenSerial(portName, baud);
+            core->openSerial(portName, baud);
             connectButton->setText("CONNECTING...");
             connectButton->setEnabled(false);
-            appendLog("USER: USB Connection request -> " + portName);
         }
     }
 
@@ -623,36 +535,118 @@ private:
             baudSelect->setEnabled(true);
             scanButton->setEnabled(true);
         }
+        updateConnectionStatsTip();
     }
 
-    // Constructs and sends a data packet with checksum
-    void sendPacket(QString type, QString payload) {
-        if (!isBtConnected && !isUsbConnected) {
-            QMessageBox::warning(this, "Warning", "You must connect first!");
-            return;
-        }
+    // Link dropped and is being re-opened; the button cancels the retries
+    void updateUIReconnectingState(int attempt, int delayMs) {
+        connectButton->setEnabled(true);
+        connectButton->setText("CANCEL RECONNECT");
+        connectButton->setStyleSheet("");
+        statusLabel->setText(QString("STATUS: RECONNECTING (#%1 in %2 s)").arg(attempt).arg((delayMs + 999) / 1000));
+        statusLabel->setStyleSheet("color: #f9e2af; font-weight: bold; border: 2px dashed #f9e2af;");
+        connectionTypeSelect->setEnabled(false);
+        portSelect->setEnabled(false);
+        baudSelect->setEnabled(false);
+        scanButton->setEnabled(false);
+        updateConnectionStatsTip();
+    }
 
-        QString raw = type + "," + payload;
-        int checksum = 0;
-        QByteArray bytes = raw.toLatin1();
-        for(char c : bytes) {
-            checksum ^= c;
-        }
+    void updateConnectionStatsTip() {
+        ConnectionManager::Stats stats = core->connectionStats();
+        statusLabel->setToolTip(QString("Reconnects: %1\nAttempts: %2\nDowntime: %3 s\nDropped frames: %4")
+                                    .arg(stats.reconnects)
+                                    .arg(stats.attempts)
+                                    .arg(stats.downtimeMs / 1000)
+                                    .arg(stats.droppedFrames));
+    }
 
-        QString packet = "$" + raw + "*" + QString::number(checksum, 16).toUpper() + "\r\n";
+    // Rates over the last second: throughput counts every send, goodput only
+    // acked payload; the resend rate is over the whole session
+    void updateReliableStatus() {
+        ReliableLink::Stats stats = core->reliableStats();
+        quint64 throughput = stats.wireBytes - lastReliableStats.wireBytes;
+        quint64 goodput = stats.goodBytes - lastReliableStats.goodBytes;
+        quint64 sends = stats.packets + stats.retransmits;
+        lastReliableStats = stats;
 
-        if (isBtConnected) {
-            btSocket->write(packet.toUtf8());
-        } else if (isUsbConnected) {
-            emit operateWriteSerial(packet);
+        if (!core->isReliableActive()) {
+            reliableLabel->setText(core->isConnected() ? "RELIABLE: OFF (NO ARQ_ACK FROM PIC)" : "RELIABLE: NO LINK");
+            return;
         }
+        reliableLabel->setText(QString("RELIABLE: %1 B/s, goodput %2 B/s, %3 % resent, %4 waiting")
+                                   .arg(throughput)
+                                   .arg(goodput)
+                                   .arg(sends ? 100.0 * double(stats.retransmits) / double(sends) : 0.0, 0, 'f', 1)
+                                   .arg(core->reliablePendingCount()));
+        reliableLabel->setToolTip(QString("Packets: %1\nAcked: %2\nResent: %3\nNAKs: %4\nDropped: %5")
+                                      .arg(stats.packets)
+                                      .arg(stats.acked)
+                                      .arg(stats.retransmits)
+                                      .arg(stats.naks)
+                                      .arg(stats.failed));
+    }
+
+    static QString formatBytes(quint64 bytes) {
+        if (bytes < 10000) return QString::number(bytes) + " B";
+        if (bytes < 10000000) return QString::number(bytes / 1024) + " kB";
+        return QString::number(bytes / (1024 * 1024)) + " MB";
+    }
+
+    static QString formatLatency(qint64 ns) {
+        if (ns < 1000000) return QString::number(ns / 1000) + " us";
+        return QString::number(double(ns) / 1e6, 'f', 1) + " ms";
+    }
+
+    // Totals since start; frame rates over the last second
+    void updateMetricsPanel() {
+        const LinkMetrics &metrics = core->metrics();
+        quint64 framesInRate = metrics.framesIn - lastFramesIn;
+        quint64 framesOutRate = metrics.framesOut - lastFramesOut;
+        lastFramesIn = metrics.framesIn;
+        lastFramesOut = metrics.framesOut;
+
+        metricsLabel->setText(QString("IN  %1 %2 fr %3/s\n"
+                                      "OUT %4 %5 fr %6/s\n"
+                                      "CHECKSUM %7  UNKNOWN %8\n"
+                                      "COOLDOWN %9  BUSY %10\n"
+                                      "READ>ACT  p50 %11 p99 %12\n"
+                                      "CMD>SPAWN p50 %13 p99 %14")
+                                  .arg(formatBytes(metrics.bytesIn.load(std::memory_order_relaxed)), 8)
+                                  .arg(metrics.framesIn, 6)
+                                  .arg(framesInRate, 3)
+                                  .arg(formatBytes(metrics.bytesOut.load(std::memory_order_relaxed)), 8)
+                                  .arg(metrics.framesOut, 6)
+                                  .arg(framesOutRate, 3)
+                                  .arg(metrics.checksumErrors)
+                                  .arg(metrics.unknownCommands)
+                                  .arg(metrics.cooldownRejections)
+                                  .arg(metrics.busyRejections)
+                                  .arg(formatLatency(metrics.parseToDispatch.percentileNs(0.50)))
+                                  .arg(formatLatency(metrics.parseToDispatch.percentileNs(0.99)))
+                                  .arg(formatLatency(metrics.dispatchToSpawn.percentileNs(0.50)))
+                                  .arg(formatLatency(metrics.dispatchToSpawn.percentileNs(0.99))));
+        metricsLabel->setToolTip(QString("Frames read, then acted on: %1 (max %2)\nCommands started: %3 (max %4)")
+                                     .arg(metrics.parseToDispatch.count)
+                                     .arg(formatLatency(metrics.parseToDispatch.maxNs))
+                                     .arg(metrics.dispatchToSpawn.count)
+                                     .arg(formatLatency(metrics.dispatchToSpawn.maxNs)));
+    }
+
+    // Sends a packet through the core, warning if no link is open
+    bool sendPacket(QString type, QString payload) {
+        if (!core->sendPacket(type, payload)) {
+            QMessageBox::warning(this, "Warning", "You must connect first!");
+            return false;
+        }
+        return true;
     }
 
     void sendMessage() {
         QString msg = messageInput->text();
         if (msg.isEmpty()) return;
 
-        sendPacket("M", msg);
+        if (!sendPacket("M", msg)) return;
         appendChat(msg, true);
         appendLog("SENT ($M): " + msg);
         messageInput->clear();
@@ -662,158 +656,70 @@ private:
         QString cmd = customCmdInput->text();
         if (cmd.isEmpty()) cmd = "PING"; 
 
-        sendPacket("K", cmd);
+        if (!sendPacket("K", cmd)) return;
         appendLog("COMMAND SENT ($K): " + cmd);
         customCmdInput->clear();
     }
 
-// Parses incoming raw data strings
-void processIncomingData(QString line) {
-    if (line.isEmpty()) return;
-    if (!line.startsWith("$")) return;
-
-    // Checksum Ayrıştırma
-    int starIndex = line.indexOf('*');
-    if (starIndex == -1) return;
-
-    QString content = line.mid(1, starIndex - 1); // $ ve * arasını al
-    QString receivedChecksumStr = line.mid(starIndex + 1).trimmed();
-    
-    // Checksum Hesaplama ve Doğrulama
-    int receivedChecksum = receivedChecksumStr.toInt(nullptr, 16);
-    int calculatedChecksum = 0;
-    QByteArray bytes = content.toLatin1();
-    for(char c : bytes) {
-        calculatedChecksum ^= c;
-    }
-
-    if (calculatedChecksum != receivedChecksum) {
-        appendLog("ERROR: Checksum Hatası! (" + content + ")");
-        return;
-    }
-
-    if (content.startsWith("K,")) {
-        QString cleanCmd = content.mid(2); 
-        
-        appendLog("INCOMING COMMAND: " + cleanCmd);
-        handleSystemCommand(cleanCmd);
-    } 
-    else if (content.startsWith("M,")) {
-        QString msgContent = content.mid(2);
-        appendChat(msgContent, false);
-        appendLog("INCOMING MESSAGE: " + msgContent);
-    }
-}
-
-// Executes system commands based on received data
-void handleSystemCommand(QString cmdKey) {
-    cmdKey = cmdKey.toUpper().trimmed(); 
-    
-    if (commandMap.contains(cmdKey)) {
-        CommandConfig &cfg = commandMap[cmdKey];
-        qint64 now = QDateTime::currentMSecsSinceEpoch();
-
-        if (now - cfg.lastRunTime > cfg.offsetMs) {
-            QStringList args;
-            args << "-c" << cfg.systemCommand;
-            QProcess::startDetached("/bin/sh", args);
-            cfg.lastRunTime = now;
-            appendLog("SYSTEM ACTION: " + cfg.systemCommand);
-        } else {
-            appendLog("SYSTEM: " + cmdKey + " (Bekleme Süresinde)");
-        }
-    } else {
-        appendLog("UNKNOWN COMMAND: " + cmdKey);
-    }
-}
-
-    // Appends text to the log window and file
+    // Log lines are timestamped and written to telegraph.log by the core
     void appendLog(QString text) {
-        QString currentDate = QDateTime::currentDateTime().toString("dd.MM.yyyy");
-        QString currentTime = QDateTime::currentDateTime().toString("HH:mm:ss");
-
-        if (currentDate != lastLogDate) {
-            logDisplay->setAlignment(Qt::AlignCenter);
-            logDisplay->append("\n--- " + currentDate + " ---\n");
-            logDisplay->setAlignment(Qt::AlignLeft);
-            lastLogDate = currentDate;
-        }
-
-        logDisplay->append("[" + currentTime + "] " + text);
-        writeToFile("[" + currentDate + " " + currentTime + "] " + text);
-        logDisplay->verticalScrollBar()->setValue(logDisplay->verticalScrollBar()->maximum());
+        core->log(text);
     }
 
+    // Queues a line for telegraph.log only
     void writeToFile(QString text) {
-        QFile file("telegraph.log");
-        if (file.open(QIODevice::Append | QIODevice::Text)) {
-            QTextStream out(&file);
-            out << text << "\n";
-            file.close();
-        }
+        core->writeToFile(text);
     }
 
-    // Appends message to the chat display with HTML styling
+    // Appends an outgoing message to the chat view; the delegate draws the bubble
     void appendChat(QString text, bool isMe) {
-        QString align = isMe ? "right" : "left";
-        QString bgColor = isMe ? (isDarkTheme ? "#313244" : "#bcc0cc") : (isDarkTheme ? "#45475a" : "#9ca0b0"); 
-        QString textColor = isDarkTheme ? "#cdd6f4" : "#303446";
-        QString timeStr = QDateTime::currentDateTime().toString("HH:mm");
-        QString html = QString(
-            "<div align='%1' style='margin-bottom:10px;'>"
-            "<span style='background-color:%2; color:%3; padding:10px; font-size:14px; text-decoration:none;'>"
-            "%4"
-            "<br><small style='color:%3; opacity:0.7; font-size:10px;'>%5</small>"
-            "</span>"
-            "</div>"
-        ).arg(align).arg(bgColor).arg(textColor).arg(text).arg(timeStr);
-        
-        chatDisplay->append(html);
-        chatDisplay->verticalScrollBar()->setValue(chatDisplay->verticalScrollBar()->maximum());
-    }
-
-    void loadSystemCommands() {
-        QString configPath = QCoreApplication::applicationDirPath() + "/.config/Command.json";
-        QFile file(configPath);
-
-        if (!file.open(QIODevice::ReadOnly)) {
-            appendLog("SYSTEM ERROR: Config file not found at " + configPath);
-            return;
-        }
-
-        QByteArray data = file.readAll();
-        file.close();
+        MessageRingModel::Entry entry;
+        entry.text = text;
+        entry.time = QDateTime::currentDateTime().toString("HH:mm");
+        entry.outgoing = isMe;
+        chatModel->append(entry);
+    }
+
+    // Adds a run of core log lines to the log view, with a separator when the date changes
+    void showLogLines(const QVector<TelegraphCore::Line> &lines) {
+        QVector<MessageRingModel::Entry> rows;
+        rows.reserve(lines.size() + 1);
+        for (const TelegraphCore::Line &line : lines) {
+            if (line.date != lastLogDate) {
+                MessageRingModel::Entry separator;
+                separator.text = "--- " + line.date + " ---";
+                separator.separator = true;
+                rows.append(separator);
+                lastLogDate = line.date;
+            }
 
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isNull() || !doc.isObject()) {
-            appendLog("SYSTEM ERROR: Config JSON is invalid.");
-            return;
+            MessageRingModel::Entry entry;
+            entry.text = "[" + line.time + "] " + line.text;
+            rows.append(entry);
         }
+        logModel->append(rows);
+    }
 
-        QJsonObject root = doc.object();
-        commandMap.clear();
-
-        for (const QString &key : root.keys()) {
-            QJsonObject cmdObj = root.value(key).toObject();
-            
-            CommandConfig config;
-            config.systemCommand = cmdObj["cmd"].toString();
-            config.offsetMs = cmdObj["timeout"].toInt(2000);
-            config.lastRunTime = 0;
-
-            commandMap.insert(key, config);
+    void showIncomingMessages(const QVector<TelegraphCore::Line> &messages) {
+        QVector<MessageRingModel::Entry> rows;
+        rows.reserve(messages.size());
+        for (const TelegraphCore::Line &message : messages) {
+            MessageRingModel::Entry entry;
+            entry.text = message.text;
+            entry.time = message.time.left(5);
+            rows.append(entry);
         }
-        appendLog("SYSTEM: " + QString::number(commandMap.size()) + " commands loaded from config.");
+        chatModel->append(rows);
     }
-
-signals:
-    void operateOpenSerial(QString name, int baud);
-    void operateCloseSerial();
-    void operateWriteSerial(QString data);
 };
 
 int main(int argc, char *argv[]) {
+#ifdef Q_OS_UNIX
+    // Fork the command spawner while the process is still small and single-threaded
+    SpawnHelper::launch();
+#endif
     QApplication app(argc, argv);
+    TelegraphCore::registerMetaTypes();
     TelegraphWindow window;
     window.show();
     return app.exec();
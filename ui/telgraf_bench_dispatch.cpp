@@ -0,0 +1,173 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTextStream>
+
+#include "CommandTable.h"
+
+// Command.json with `count` commands "CMD0".."CMD<count-1>", no cooldown
+static QByteArray makeCommandJson(int count) {
+    QJsonObject root;
+    for (int i = 0; i < count; i++) {
+        QJsonObject cmd;
+        cmd["cmd"] = QString("echo command %1 >/dev/null").arg(i);
+        cmd["timeout"] = 0;
+        root[QString("CMD%1").arg(i)] = cmd;
+    }
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+// `$K` payloads as the PIC sends them: mixed case, stray blanks, one in ten unknown
+static QVector<QByteArray> makePayloads(int commands, int count) {
+    QVector<QByteArray> payloads;
+    payloads.reserve(count);
+    quint32 seed = 1;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int index = int((seed >> 8) % quint32(commands));
+        QByteArray key = "CMD" + QByteArray::number(index);
+        if (i % 10 == 9) key = "NOPE" + QByteArray::number(index);
+        else if (i % 3 == 1) key = key.toLower();
+        else if (i % 3 == 2) key = " " + key + " ";
+        payloads.append(key);
+    }
+    return payloads;
+}
+
+struct Run {
+    qint64 ns = 0;
+    quint64 lookups = 0;
+    quint64 hits = 0;
+    quint64 sink = 0;       // Command indices and argument counts, keeps the work
+};
+
+// The compiled table as handleSystemCommand uses it: lookup on the raw
+// payload, cooldown, then the pre-split arguments
+static Run runTable(CommandTable &table, const QVector<QByteArray> &payloads, int passes) {
+    Run run;
+    QElapsedTimer clock;
+    clock.start();
+    for (int pass = 0; pass < passes; pass++) {
+        for (const QByteArray &payload : payloads) {
+            run.lookups++;
+            int index = table.find(payload);
+            if (index < 0) continue;
+            run.hits++;
+            if (table.tryAcquire(index, QDateTime::currentMSecsSinceEpoch())) {
+                run.sink += quint64(index) + quint64(table.spec(index).arguments.size());
+            }
+        }
+    }
+    run.ns = clock.nsecsElapsed();
+    return run;
+}
+
+// What handleSystemCommand did before the table: upper-case and trim a
+// QString, look it up in a QMap and build the /bin/sh argument list
+struct LegacyCommand {
+    QString systemCommand;
+    qint64 lastRunTime = 0;
+    int offsetMs = 0;
+};
+
+static Run runQMap(QMap<QString, LegacyCommand> &commandMap, const QVector<QString> &payloads, int passes) {
+    Run run;
+    QElapsedTimer clock;
+    clock.start();
+    for (int pass = 0; pass < passes; pass++) {
+        for (QString cmdKey : payloads) {
+            run.lookups++;
+            cmdKey = cmdKey.toUpper().trimmed();
+            if (!commandMap.contains(cmdKey)) continue;
+            run.hits++;
+            LegacyCommand &cfg = commandMap[cmdKey];
+            qint64 now = QDateTime::currentMSecsSinceEpoch();
+            if (now - cfg.lastRunTime > cfg.offsetMs) {
+                QStringList args;
+                args << "-c" << cfg.systemCommand;
+                cfg.lastRunTime = now;
+                run.sink += quint64(args.size());
+            }
+        }
+    }
+    run.ns = clock.nsecsElapsed();
+    return run;
+}
+
+static void printRun(QTextStream &out, const char *name, const Run &run) {
+    double seconds = qMax(1e-9, double(run.ns) / 1e9);
+    out << QString("  %1: %2 lookups/s, %3 ns per lookup, %4 hits\n")
+               .arg(QString::fromLatin1(name), -15)
+               .arg(double(run.lookups) / seconds, 0, 'f', 0)
+               .arg(double(run.ns) / double(qMax<quint64>(1, run.lookups)), 0, 'f', 0)
+               .arg(run.hits);
+}
+
+// Measures `$K` dispatch with thousands of configured commands: the compiled
+// CommandTable against the QMap lookup it replaced, on the same payloads.
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_bench_dispatch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks Command.json dispatch");
+    parser.addHelpOption();
+    QCommandLineOption commandsOption("commands", "Commands in the generated Command.json.", "n", "5000");
+    QCommandLineOption framesOption("frames", "$K payloads per pass.", "n", "100000");
+    QCommandLineOption passesOption("passes", "Passes over the payloads.", "n", "10");
+    parser.addOptions({commandsOption, framesOption, passesOption});
+    parser.process(app);
+
+    const int commands = qMax(1, parser.value(commandsOption).toInt());
+    const int passes = qMax(1, parser.value(passesOption).toInt());
+    const QVector<QByteArray> payloads = makePayloads(commands, qMax(1, parser.value(framesOption).toInt()));
+    const QByteArray json = makeCommandJson(commands);
+
+    // Compiling the table, as on every (re)load of Command.json
+    CommandTable table;
+    QString error;
+    QElapsedTimer clock;
+    clock.start();
+    bool loaded = table.loadJson(json, &error);
+    qint64 loadNs = clock.nsecsElapsed();
+    if (!loaded) {
+        QTextStream(stderr) << "ERROR: " << error << "\n";
+        return 2;
+    }
+
+    QMap<QString, LegacyCommand> commandMap;
+    const QJsonObject root = QJsonDocument::fromJson(json).object();
+    for (auto it = root.begin(); it != root.end(); ++it) {
+        LegacyCommand cfg;
+        cfg.systemCommand = it.value().toObject()["cmd"].toString();
+        cfg.offsetMs = it.value().toObject()["timeout"].toInt(2000);
+        commandMap.insert(it.key().toUpper(), cfg);
+    }
+    QVector<QString> legacyPayloads;
+    legacyPayloads.reserve(payloads.size());
+    for (const QByteArray &payload : payloads) legacyPayloads.append(QString::fromUtf8(payload));
+
+    // Warm up both paths once before measuring
+    runTable(table, payloads, 1);
+    runQMap(commandMap, legacyPayloads, 1);
+
+    Run compiled = runTable(table, payloads, passes);
+    Run legacy = runQMap(commandMap, legacyPayloads, passes);
+
+    QTextStream out(stdout);
+    out << QString("%1 commands (Command.json %2 kB, compiled in %3 ms), %4 payloads x %5 passes\n")
+               .arg(commands)
+               .arg(json.size() / 1024)
+               .arg(double(loadNs) / 1e6, 0, 'f', 1)
+               .arg(payloads.size())
+               .arg(passes);
+    printRun(out, "CommandTable", compiled);
+    printRun(out, "QMap<QString>", legacy);
+    if (compiled.hits != legacy.hits) out << "  WARNING: the two paths found different commands\n";
+    out.flush();
+    return 0;
+}
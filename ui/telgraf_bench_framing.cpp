@@ -0,0 +1,127 @@
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QString>
+#include <QTextStream>
+#include <cstring>
+
+#include "BinaryFraming.h"
+#include "NmeaParser.h"
+
+// "$M,payload*CS\r\n" as send_nmea_packet puts it on the wire
+static QByteArray nmeaFrame(char type, const QByteArray &payload) {
+    QByteArray body = QByteArray(1, type) + "," + payload;
+    quint8 checksum = 0;
+    for (char c : body) checksum ^= quint8(c);
+    return "$" + body + "*" + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+}
+
+struct Trials {
+    quint64 corrupted = 0;      // Damaged frames fed to the parser
+    quint64 undetected = 0;     // ... and still came out as a valid, different frame
+};
+
+// Feeds one damaged frame to a fresh parser. True if it hands out a valid
+// frame that is not the one that was sent.
+static bool passesUndetected(const QByteArray &wire, char type, const QByteArray &payload) {
+    NmeaParser parser;
+    bool undetected = false;
+    parser.feed(QByteArrayView(wire), [&](const LinkFrame &frame) {
+        if (frame.status != LinkFrame::Valid) return;
+        if (frame.type != type || frame.length != payload.size() ||
+            memcmp(frame.payload, payload.constData(), frame.length) != 0) {
+            undetected = true;
+        }
+    });
+    return undetected;
+}
+
+static quint32 nextRandom(quint32 &seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// Flips two different bits anywhere in the frame, delimiters included
+static Trials flipTwoBits(const QByteArray &wire, char type, const QByteArray &payload, int trials) {
+    Trials result;
+    quint32 seed = 1;
+    const quint32 bits = quint32(wire.size()) * 8;
+    for (int i = 0; i < trials; i++) {
+        quint32 first = nextRandom(seed) % bits;
+        quint32 second = nextRandom(seed) % (bits - 1);
+        if (second >= first) second++;
+        QByteArray damaged = wire;
+        damaged[int(first / 8)] = char(damaged[int(first / 8)] ^ (1 << (first % 8)));
+        damaged[int(second / 8)] = char(damaged[int(second / 8)] ^ (1 << (second % 8)));
+        result.corrupted++;
+        if (passesUndetected(damaged, type, payload)) result.undetected++;
+    }
+    return result;
+}
+
+// Swaps every pair of neighbouring bytes that differ, one pair per trial
+static Trials swapNeighbours(const QByteArray &wire, char type, const QByteArray &payload) {
+    Trials result;
+    for (int at = 0; at + 1 < wire.size(); at++) {
+        if (wire[at] == wire[at + 1]) continue;
+        QByteArray damaged = wire;
+        damaged[at] = wire[at + 1];
+        damaged[at + 1] = wire[at];
+        result.corrupted++;
+        if (passesUndetected(damaged, type, payload)) result.undetected++;
+    }
+    return result;
+}
+
+static QString percent(const Trials &trials) {
+    return QString("%1 % (%2 of %3)")
+        .arg(100.0 * double(trials.undetected) / double(qMax<quint64>(1, trials.corrupted)), 0, 'f', 1)
+        .arg(trials.undetected)
+        .arg(trials.corrupted);
+}
+
+// Compares the binary framing with NMEA text for one message: bytes on the
+// wire, effective payload bytes/s at the given baud rate (8N1) and how many
+// damaged frames each receiver still accepts as valid.
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_bench_framing");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks binary framing against NMEA text");
+    parser.addHelpOption();
+    QCommandLineOption payloadOption("payload", "Message length in characters.", "n", "10");
+    QCommandLineOption baudOption("baud", "Link baud rate.", "rate", "9600");
+    QCommandLineOption trialsOption("trials", "Two-bit error trials per format.", "n", "200000");
+    parser.addOptions({payloadOption, baudOption, trialsOption});
+    parser.process(app);
+
+    const QByteArray text = "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG";
+    const int length = qBound(1, parser.value(payloadOption).toInt(), int(qMin<qsizetype>(text.size(), BinaryFraming::MaxPayload)));
+    const double bytesPerSecond = double(qMax(1, parser.value(baudOption).toInt())) / 10.0;
+    const int trials = qMax(1, parser.value(trialsOption).toInt());
+
+    const QByteArray payload = text.left(length);
+    const QByteArray nmea = nmeaFrame('M', payload);
+    const QByteArray binary = BinaryFraming::encode('M', payload);
+
+    Trials nmeaFlips = flipTwoBits(nmea, 'M', payload, trials);
+    Trials binaryFlips = flipTwoBits(binary, 'M', payload, trials);
+    Trials nmeaSwaps = swapNeighbours(nmea, 'M', payload);
+    Trials binarySwaps = swapNeighbours(binary, 'M', payload);
+
+    QTextStream out(stdout);
+    out << QString("%1-character payload at %2 baud: NMEA / binary\n").arg(length).arg(bytesPerSecond * 10.0, 0, 'f', 0);
+    out << QString("  bytes on the wire:            %1 / %2\n").arg(nmea.size()).arg(binary.size());
+    out << QString("  effective payload throughput: %1 / %2 B/s\n")
+               .arg(bytesPerSecond * length / double(nmea.size()), 0, 'f', 0)
+               .arg(bytesPerSecond * length / double(binary.size()), 0, 'f', 0);
+    out << QString("  undetected 2-bit errors:      %1 / %2\n")
+               .arg(percent(nmeaFlips))
+               .arg(percent(binaryFlips));
+    out << QString("  undetected neighbour swaps:   %1 / %2\n")
+               .arg(percent(nmeaSwaps))
+               .arg(percent(binarySwaps));
+    out.flush();
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <thread>
+
+#include "AsyncLogger.h"
+
+// A log line as TelegraphCore writes it for an incoming message
+static QByteArray logLine(int i) {
+    return "[17.10.2026 12:34:56] INCOMING MESSAGE: CQ CQ DE TA1ABC " + QByteArray::number(i);
+}
+
+struct Run {
+    qint64 callerNs = 0;    // Time spent in the logging calls
+    qint64 totalNs = 0;     // Until every line was in the file
+    quint64 ringFull = 0;   // AsyncLogger only: calls retried because the ring was full
+    qint64 fileBytes = 0;
+};
+
+// What TelegraphWindow::writeToFile did for every line: open, write through
+// a QTextStream, close
+static Run runOpenAppendClose(const QString &path, int lines) {
+    Run run;
+    QElapsedTimer clock;
+    clock.start();
+    for (int i = 0; i < lines; i++) {
+        QFile file(path);
+        if (file.open(QIODevice::Append | QIODevice::Text)) {
+            QTextStream out(&file);
+            out << QString::fromUtf8(logLine(i)) << "\n";
+            file.close();
+        }
+    }
+    run.callerNs = run.totalNs = clock.nsecsElapsed();
+    run.fileBytes = QFileInfo(path).size();
+    return run;
+}
+
+// AsyncLogger with rotation off and the station's ring size. A full ring is
+// waited out, so every line reaches the file and the figure is the sustained
+// rate (the logger notes each full ring in the file).
+static Run runAsyncLogger(const QString &path, int lines) {
+    AsyncLogger::Options options;
+    options.path = path;
+    options.maxFileBytes = 0;
+    options.rotateDaily = false;
+
+    Run run;
+    QElapsedTimer clock;
+    AsyncLogger logger(options);
+    clock.start();
+    for (int i = 0; i < lines; i++) {
+        QByteArray line = logLine(i);
+        while (!logger.log(line)) {
+            run.ringFull++;
+            std::this_thread::yield();
+        }
+    }
+    run.callerNs = clock.nsecsElapsed();
+    logger.stop();
+    run.totalNs = clock.nsecsElapsed();
+    run.fileBytes = QFileInfo(path).size();
+    return run;
+}
+
+static void printRun(QTextStream &out, const char *name, const Run &run, int lines) {
+    out << QString("  %1: %2 lines/s to disk, %3 ns per call in the caller, %4 kB written")
+               .arg(QString::fromLatin1(name), -19)
+               .arg(double(lines) / qMax(1e-9, double(run.totalNs) / 1e9), 0, 'f', 0)
+               .arg(double(run.callerNs) / double(lines), 0, 'f', 0)
+               .arg(run.fileBytes / 1024);
+    if (run.ringFull > 0) out << QString(", ring full %1 times").arg(run.ringFull);
+    out << "\n";
+}
+
+// Measures the lines per second telegraph.log takes with AsyncLogger and
+// with the open/append/close per line it replaced, in a temporary directory.
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_bench_logger");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the telegraph.log writer");
+    parser.addHelpOption();
+    QCommandLineOption linesOption("lines", "Lines written by each logger.", "n", "100000");
+    parser.addOptions({linesOption});
+    parser.process(app);
+
+    const int lines = qMax(1, parser.value(linesOption).toInt());
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        QTextStream(stderr) << "ERROR: cannot create a temporary directory\n";
+        return 2;
+    }
+
+    Run async = runAsyncLogger(dir.filePath("async.log"), lines);
+    Run legacy = runOpenAppendClose(dir.filePath("legacy.log"), lines);
+
+    QTextStream out(stdout);
+    out << QString("%1 lines of up to %2 bytes\n").arg(lines).arg(logLine(lines).size() + 1);
+    printRun(out, "AsyncLogger", async, lines);
+    printRun(out, "open/append/close", legacy, lines);
+    if (async.ringFull == 0 && async.fileBytes != legacy.fileBytes) {
+        out << "  WARNING: the two logs differ in size\n";
+    }
+    out.flush();
+    return 0;
+}
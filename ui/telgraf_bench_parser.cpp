@@ -0,0 +1,195 @@
+#include <QBuffer>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+#include <cstdlib>
+
+#include "NmeaParser.h"
+
+// Heap allocations are counted by wrapping malloc, which also catches the
+// QString/QByteArray data blocks that never go through operator new. Only
+// possible on glibc; elsewhere the counts are reported as unknown.
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+static bool countAllocations = false;
+static quint64 allocations = 0;
+
+extern "C" void *malloc(size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_realloc(p, size);
+}
+#endif
+
+static QByteArray nmeaFrame(char type, const QByteArray &payload) {
+    QByteArray body = QByteArray(1, type) + "," + payload;
+    quint8 checksum = 0;
+    for (char c : body) checksum ^= quint8(c);
+    return "$" + body + "*" + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+}
+
+// PIC traffic: mostly messages, some commands and status reports
+static QByteArray makeTraffic(int frames, int *validFrames) {
+    static const char *messages[] = {"HELLO", "SOS", "CQ CQ DE TA1ABC", "THE QUICK BROWN FOX", "73"};
+    static const char *commands[] = {"BR", "VOL_UP", "led_set,1", "SCREENSHOT"};
+    QByteArray traffic;
+    for (int i = 0; i < frames; i++) {
+        if (i % 10 < 7) traffic += nmeaFrame('M', QByteArray(messages[i % 5]) + " " + QByteArray::number(i));
+        else if (i % 10 < 9) traffic += nmeaFrame('K', commands[i % 4]);
+        else traffic += nmeaFrame('S', "ovf=0,long=0,err=" + QByteArray::number(i));
+    }
+    *validFrames = frames;
+    return traffic;
+}
+
+struct Run {
+    qint64 ns = 0;
+    quint64 frames = 0;
+    quint64 allocations = 0;
+    quint64 sink = 0;       // Sum over type and length, the same for both paths
+};
+
+// The incremental parser, fed in `chunk`-byte reads as from the serial port
+static Run runParser(const QByteArray &traffic, int chunk, int passes) {
+    NmeaParser parser;
+    Run run;
+    QElapsedTimer clock;
+#ifdef __GLIBC__
+    allocations = 0;
+    countAllocations = true;
+#endif
+    clock.start();
+    for (int pass = 0; pass < passes; pass++) {
+        for (qsizetype at = 0; at < traffic.size(); at += chunk) {
+            QByteArrayView data(traffic.constData() + at, qMin<qsizetype>(chunk, traffic.size() - at));
+            parser.feed(data, [&run](const LinkFrame &frame) {
+                run.frames++;
+                run.sink += quint8(frame.type) + frame.length + (frame.status == LinkFrame::Valid);
+            });
+        }
+    }
+    run.ns = clock.nsecsElapsed();
+#ifdef __GLIBC__
+    countAllocations = false;
+    run.allocations = allocations;
+#endif
+    return run;
+}
+
+// What the station did before NmeaParser: readLine().trimmed() and
+// fromUtf8 in the worker, then QString slicing in processIncomingData
+static Run runQStringPath(const QByteArray &traffic, int passes) {
+    Run run;
+    QElapsedTimer clock;
+    QByteArray copy = traffic;
+    QBuffer device(&copy);
+#ifdef __GLIBC__
+    allocations = 0;
+    countAllocations = true;
+#endif
+    clock.start();
+    for (int pass = 0; pass < passes; pass++) {
+        device.open(QIODevice::ReadOnly);
+        while (device.canReadLine()) {
+            QByteArray data = device.readLine().trimmed();
+            QString line = QString::fromUtf8(data);
+            if (line.isEmpty() || !line.startsWith("$")) continue;
+            int starIndex = line.indexOf('*');
+            if (starIndex == -1) continue;
+
+            QString content = line.mid(1, starIndex - 1);
+            QString receivedChecksumStr = line.mid(starIndex + 1).trimmed();
+            int receivedChecksum = receivedChecksumStr.toInt(nullptr, 16);
+            int calculatedChecksum = 0;
+            QByteArray bytes = content.toLatin1();
+            for (char c : bytes) calculatedChecksum ^= c;
+            if (calculatedChecksum != receivedChecksum) continue;
+
+            QString payload = content.mid(2);
+            run.frames++;
+            run.sink += content.at(0).unicode() + quint64(payload.size()) + 1;
+        }
+        device.close();
+    }
+    run.ns = clock.nsecsElapsed();
+#ifdef __GLIBC__
+    countAllocations = false;
+    run.allocations = allocations;
+#endif
+    return run;
+}
+
+static void printRun(QTextStream &out, const char *name, const Run &run, quint64 bytes) {
+    double seconds = qMax(1e-9, double(run.ns) / 1e9);
+    double bytesPerSecond = double(bytes) / seconds;
+    out << QString("  %1: %2 frames/s, %3 MB/s (%4 x 115200 baud), ")
+               .arg(QString::fromLatin1(name), -13)
+               .arg(double(run.frames) / seconds, 0, 'f', 0)
+               .arg(bytesPerSecond / 1e6, 0, 'f', 2)
+               .arg(bytesPerSecond / 11520.0, 0, 'f', 0);
+#ifdef __GLIBC__
+    out << QString("%1 allocations per frame\n")
+               .arg(run.frames ? double(run.allocations) / double(run.frames) : 0.0, 0, 'f', 2);
+#else
+    out << "allocations not counted on this platform\n";
+#endif
+}
+
+// Measures NmeaParser against the QString path it replaced on generated PIC
+// traffic: frames per second, headroom over a 115200 baud link and heap
+// allocations per valid frame.
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_bench_parser");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the NMEA frame parser");
+    parser.addHelpOption();
+    QCommandLineOption framesOption("frames", "Frames in the generated traffic.", "n", "20000");
+    QCommandLineOption passesOption("passes", "Passes over the traffic per run.", "n", "50");
+    QCommandLineOption chunkOption("chunk", "Bytes handed to the parser per read.", "bytes", "64");
+    parser.addOptions({framesOption, passesOption, chunkOption});
+    parser.process(app);
+
+    int validFrames = 0;
+    const QByteArray traffic = makeTraffic(qMax(1, parser.value(framesOption).toInt()), &validFrames);
+    const int passes = qMax(1, parser.value(passesOption).toInt());
+    const int chunk = qMax(1, parser.value(chunkOption).toInt());
+    const quint64 bytes = quint64(traffic.size()) * quint64(passes);
+
+    // Warm up caches and Qt's lazily built tables before measuring
+    runParser(traffic, chunk, 1);
+    runQStringPath(traffic, 1);
+
+    Run parsed = runParser(traffic, chunk, passes);
+    Run legacy = runQStringPath(traffic, passes);
+
+    QTextStream out(stdout);
+    out << QString("%1 frames, %2 bytes, %3 passes, %4-byte reads\n")
+               .arg(validFrames)
+               .arg(traffic.size())
+               .arg(passes)
+               .arg(chunk);
+    printRun(out, "NmeaParser", parsed, bytes);
+    printRun(out, "QString path", legacy, bytes);
+    if (parsed.frames != quint64(validFrames) * quint64(passes) || parsed.sink != legacy.sink) {
+        out << "  WARNING: the two paths decoded different frames\n";
+    }
+    out.flush();
+    return 0;
+}
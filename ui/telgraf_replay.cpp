@@ -0,0 +1,203 @@
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QTextStream>
+#include <QTimer>
+
+#include "TelegraphCore.h"
+
+// Link worker without a port: each captured chunk is parsed and batched by
+// the same LinkWorker code that handles a live read
+class ReplayWorker : public LinkWorker {
+public:
+    // Handles a chunk as if it had just been read off the link
+    void feed(QByteArrayView chunk) {
+        buffer.close();
+        buffer.setData(QByteArray::fromRawData(chunk.data(), chunk.size()));
+        buffer.open(QIODevice::ReadOnly);
+        readAvailable();
+    }
+
+protected:
+    QIODevice *device() const override { return &buffer; }
+
+private:
+    mutable QBuffer buffer;
+};
+
+// Figures of one run for the report
+struct ReplayStats {
+    quint64 chunksIn = 0;
+    quint64 bytesIn = 0;
+    quint64 writesInCapture = 0;
+    qint64 captureNs = 0;       // Time of the last record
+};
+
+static QString formatLatency(qint64 ns) {
+    if (ns < 1000000) return QString::number(ns / 1000) + " us";
+    return QString::number(double(ns) / 1e6, 'f', 2) + " ms";
+}
+
+static void printReport(const QString &path, const TrafficCapture::Reader &reader, const ReplayStats &stats,
+                        const LinkMetrics &metrics, qint64 elapsedNs, const QString &mode) {
+    double seconds = qMax(1e-9, double(elapsedNs) / 1e9);
+    QTextStream out(stdout);
+    out << QString("Replayed %1 (recorded %2, %3 s of traffic%4)\n")
+               .arg(path)
+               .arg(QDateTime::fromMSecsSinceEpoch(reader.startedMsSinceEpoch()).toString("dd.MM.yyyy HH:mm:ss"))
+               .arg(double(stats.captureNs) / 1e9, 0, 'f', 1)
+               .arg(reader.isTruncated() ? ", cut short" : "");
+    out << QString("  input            : %1 chunks, %2 bytes from the PIC; %3 writes to the PIC in the capture\n")
+               .arg(stats.chunksIn)
+               .arg(stats.bytesIn)
+               .arg(stats.writesInCapture);
+    out << QString("  pipeline         : %1 frames (%2 checksum errors), %3 commands started, %4 unknown, %5 rejected, %6 packets written\n")
+               .arg(metrics.framesIn)
+               .arg(metrics.checksumErrors)
+               .arg(metrics.dispatchToSpawn.count)
+               .arg(metrics.unknownCommands)
+               .arg(metrics.cooldownRejections + metrics.busyRejections)
+               .arg(metrics.framesOut);
+    out << QString("  time             : %1 s (%2), %3 MB/s, %4 frames/s\n")
+               .arg(seconds, 0, 'f', 3)
+               .arg(mode)
+               .arg(double(stats.bytesIn) / seconds / 1e6, 0, 'f', 2)
+               .arg(double(metrics.framesIn) / seconds, 0, 'f', 0);
+    out << QString("  read to dispatch : p50 %1, p99 %2, max %3\n")
+               .arg(formatLatency(metrics.parseToDispatch.percentileNs(0.50)))
+               .arg(formatLatency(metrics.parseToDispatch.percentileNs(0.99)))
+               .arg(formatLatency(metrics.parseToDispatch.maxNs));
+    out.flush();
+}
+
+// Feeds a capture made with Link/CaptureFile (or telgrafd --capture) through
+// the parser, batching and dispatch code of a live link, at the recorded pace
+// (--speed) or as fast as possible (--fast), and reports the throughput.
+// Command.json commands are looked up and rate limited but only started with
+// --run-commands.
+int main(int argc, char *argv[]) {
+#ifdef Q_OS_UNIX
+    // Fork the command spawner while the process is still small and single-threaded
+    SpawnHelper::launch();
+#endif
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_replay");
+    TelegraphCore::registerMetaTypes();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a raw link capture through the station's parser and dispatcher");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Capture file written with Link/CaptureFile.");
+    QCommandLineOption configOption({"c", "config"}, "Directory holding TelgrafApp.conf and Command.json.", "dir",
+                                    QCoreApplication::applicationDirPath() + "/.config");
+    QCommandLineOption fastOption("fast", "Feed the capture as fast as possible instead of at the recorded pace.");
+    QCommandLineOption speedOption("speed", "Pace factor for timed replay (2 = twice as fast).", "factor", "1");
+    QCommandLineOption repeatOption("repeat", "Passes over the capture with --fast.", "n", "1");
+    QCommandLineOption runOption("run-commands", "Really start the commands from Command.json.");
+    QCommandLineOption verboseOption({"v", "verbose"}, "Echo log lines.");
+    parser.addOptions({configOption, fastOption, speedOption, repeatOption, runOption, verboseOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    if (parser.positionalArguments().size() != 1) parser.showHelp(2);
+    const QString path = parser.positionalArguments().first();
+
+    QFile file(path);
+    uchar *mapped = file.open(QIODevice::ReadOnly) ? file.map(0, file.size()) : nullptr;
+    if (!mapped) {
+        err << "ERROR: cannot map " << path << " (" << file.errorString() << ")\n";
+        return 2;
+    }
+    TrafficCapture::Reader reader(QByteArrayView(reinterpret_cast<const char *>(mapped), file.size()));
+    if (!reader.isValid()) {
+        err << "ERROR: " << path << " is not a capture file (version " << TrafficCapture::Version << ")\n";
+        return 2;
+    }
+
+    TelegraphCore core(parser.value(configOption));
+    core.setCommandDryRun(!parser.isSet(runOption));
+
+    QTextStream out(stdout);
+    if (parser.isSet(verboseOption)) {
+        QObject::connect(&core, &TelegraphCore::logLines, &app, [&out](const QVector<TelegraphCore::Line> &lines) {
+            for (const TelegraphCore::Line &line : lines) {
+                out << "[" << line.date << " " << line.time << "] " << line.text << "\n";
+            }
+            out.flush();
+        });
+    }
+    // Leave the station's log, capture file and metrics port alone
+    TelegraphCore::StartOptions startOptions;
+    startOptions.logFile = false;
+    startOptions.capture = false;
+    startOptions.metricsServer = false;
+    core.start(startOptions);
+
+    // Same batching as the live workers, see Link/BatchIntervalMs and Link/BatchMaxFrames
+    QSettings appSettings(core.configPath("TelgrafApp.conf"), QSettings::IniFormat);
+    ReplayWorker worker;
+    worker.setBatching(appSettings.value("Link/BatchIntervalMs", 16).toInt(),
+                       appSettings.value("Link/BatchMaxFrames", 32).toInt());
+    QObject::connect(&worker, &LinkWorker::framesReceived, &core, [&core](const QVector<LinkFrame> &frames) {
+        core.replayFrames(frames);
+    });
+
+    ReplayStats stats;
+    TrafficCapture::Record record;
+    auto feed = [&](const TrafficCapture::Record &next) {
+        stats.captureNs = next.timeNs;
+        if (next.direction == TrafficCapture::ToPic) {
+            stats.writesInCapture++;
+            return;
+        }
+        stats.chunksIn++;
+        stats.bytesIn += quint64(next.data.size());
+        worker.feed(next.data);
+    };
+
+    QElapsedTimer clock;
+    clock.start();
+
+    // Batches are handed over when full and once at the end of each pass,
+    // the batch timer never gets to run
+    if (parser.isSet(fastOption)) {
+        int passes = qMax(1, parser.value(repeatOption).toInt());
+        for (int pass = 0; pass < passes; pass++) {
+            reader.rewind();
+            while (reader.next(&record)) feed(record);
+            worker.flushFrames();
+        }
+        printReport(path, reader, stats, core.metrics(), clock.nsecsElapsed(),
+                    QString("as fast as possible, %1 passes").arg(passes));
+        return 0;
+    }
+
+    // Timed replay: each record is fed once its recorded time (scaled) has passed
+    double speed = parser.value(speedOption).toDouble();
+    if (speed <= 0) speed = 1;
+    bool pending = reader.next(&record);
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, &app, [&]() {
+        qint64 now = clock.nsecsElapsed();
+        while (pending && qint64(double(record.timeNs) / speed) <= now) {
+            feed(record);
+            pending = reader.next(&record);
+        }
+        if (pending) {
+            qint64 waitNs = qint64(double(record.timeNs) / speed) - clock.nsecsElapsed();
+            timer.start(int(qMax<qint64>(0, waitNs / 1000000)));
+            return;
+        }
+        worker.flushFrames();
+        printReport(path, reader, stats, core.metrics(), clock.nsecsElapsed(), QString("timed, x%1").arg(speed));
+        app.quit();
+    });
+    timer.start(0);
+    return app.exec();
+}
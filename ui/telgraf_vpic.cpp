@@ -0,0 +1,632 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "NmeaParser.h"
+
+// Virtual PIC for load tests without the board or Proteus. It opens a
+// pseudo-terminal that TelgrafApp or telgrafd uses as its serial port, and
+// speaks the firmware's protocol on it (src/main.c). Messages go out as
+// outbox frames "$Q,seq,M,text". The desktop answers each with
+// "$K,ack,seq", which gives the end-to-end latency of every message through
+// SerialWorker, the parser and TelegraphCore. Commands from the desktop are
+// answered as the PIC would answer them.
+//
+// Traffic is random (--rate, --count, --length) or comes from a script:
+//   <ms> frame <T,payload>           M/K go out as outbox frames, others as they are
+//   <ms> corrupt <T,payload>         The same with a wrong checksum
+//   <ms> split <T,payload>           Written in two parts, --split-gap apart
+//   <ms> burst <count> <T,payload>   The same frame back to back
+//   <ms> end                         Stop sending and wait for the last acks
+// Times count from the desktop's first heartbeat (it sends one on connect).
+// Bytes leave at the --baud wire rate.
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+class VirtualPic {
+public:
+    static constexpr int OutboxSeqLimit = 63;  // Outbox numbers 0..62, as on the PIC
+    static constexpr int ArqSeqLimit = 64;
+
+    struct Options {
+        QString script;
+        double rate = 10;           // Random messages per second, 0 = as fast as the wire allows
+        int count = 1000;           // Random messages to send
+        int length = 12;            // Characters per random message (1-20, the PIC's text buffer)
+        double corruptPercent = 0;  // Share of messages sent with a wrong checksum
+        double splitPercent = 0;    // Share of frames written in two parts
+        int splitGapMs = 5;
+        int baud = 9600;
+        int timeoutMs = 2000;       // A message not acked in this time counts as dropped
+        quint32 seed = 1;           // Same seed, same random traffic
+        bool waitForLink = true;    // Start at the first "$K,hb"
+        bool verbose = false;
+    };
+
+    VirtualPic(const Options &options, int fd) : options(options), fd(fd), random(options.seed) {
+        clock.start();
+    }
+
+    // Reads the traffic script; false with a message if a line is not understood
+    bool loadScript(QString *error) {
+        QFile file(options.script);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            *error = "cannot open " + options.script;
+            return false;
+        }
+        int lineNumber = 0;
+        while (!file.atEnd()) {
+            QByteArray line = file.readLine();
+            lineNumber++;
+            int comment = line.indexOf('#');
+            if (comment >= 0) line.truncate(comment);
+            QList<QByteArray> fields = line.simplified().split(' ');
+            if (fields.size() < 2) continue;
+
+            ScriptLine entry;
+            bool ok = false;
+            entry.atNs = qint64(fields[0].toDouble(&ok) * 1e6);
+            entry.command = fields[1];
+            if (ok && entry.command == "end") {
+                scriptEndNs = entry.atNs;
+                continue;
+            }
+            if (ok && entry.command == "burst" && fields.size() == 4) {
+                entry.count = fields[2].toInt(&ok);
+                entry.body = fields[3];
+            } else if (ok && fields.size() == 3 && (entry.command == "frame" || entry.command == "corrupt" || entry.command == "split")) {
+                entry.body = fields[2];
+            } else {
+                ok = false;
+            }
+            if (!ok || entry.body.size() < 2 || entry.body[1] != ',') {
+                *error = QString("%1:%2: cannot parse \"%3\"").arg(options.script).arg(lineNumber).arg(QString::fromUtf8(line.trimmed()));
+                return false;
+            }
+            script.append(entry);
+        }
+        std::stable_sort(script.begin(), script.end(), [](const ScriptLine &a, const ScriptLine &b) { return a.atNs < b.atNs; });
+        return true;
+    }
+
+    void run(QCoreApplication &app) {
+        QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, &app);
+        QObject::connect(notifier, &QSocketNotifier::activated, &app, [this]() { readLink(); });
+
+        QTimer *timer = new QTimer(&app);
+        timer->setTimerType(Qt::PreciseTimer);
+        QObject::connect(timer, &QTimer::timeout, &app, [this, &app, timer]() {
+            tick();
+            if (!done) return;
+            timer->stop();
+            app.exit(report());
+        });
+        timer->start(1);
+
+        lastPumpNs = clock.nsecsElapsed();
+        if (!options.waitForLink) startTraffic();
+    }
+
+private:
+    // Bytes for the wire; a chunk that completes a message stamps its send time
+    struct Chunk {
+        QByteArray bytes;
+        int offset = 0;
+        int seq = -1;               // Outbox message finished by this chunk
+        int gapMs = 0;              // Pause after the previous chunk
+        qint64 notBeforeNs = 0;
+    };
+
+    struct Message {
+        bool waiting = false;       // Sent (or queued) and not acked yet
+        bool written = false;
+        bool corrupt = false;
+        qint64 sentNs = 0;          // Last byte written
+    };
+
+    struct ScriptLine {
+        qint64 atNs = 0;
+        QByteArray command;
+        QByteArray body;
+        int count = 1;
+    };
+
+    struct Stats {
+        quint64 messages = 0;       // Outbox messages sent
+        quint64 corrupt = 0;
+        quint64 split = 0;
+        quint64 bytes = 0;
+        quint64 acked = 0;
+        quint64 dropped = 0;        // No ack within the timeout
+        quint64 lateAcks = 0;       // Acks after the timeout or for unknown numbers
+        quint64 corruptIgnored = 0;
+        quint64 corruptAccepted = 0;
+        quint64 heartbeats = 0;
+        quint64 commands = 0;
+        quint64 messagesIn = 0;
+        quint64 badFramesIn = 0;
+        quint64 naksIn = 0;
+        quint64 unknownCommands = 0;
+    };
+
+    void startTraffic() {
+        if (started) return;
+        started = true;
+        startNs = clock.nsecsElapsed();
+        nextRandomNs = startNs;
+        log("traffic started");
+    }
+
+    void log(const QString &text) {
+        if (!options.verbose) return;
+        QTextStream(stdout) << QString("[%1 ms] ").arg(clock.elapsed(), 6) << text << "\n";
+    }
+
+    void tick() {
+        qint64 now = clock.nsecsElapsed();
+        if (stopRequested) {
+            done = true;
+            return;
+        }
+        if (started) generate(now);
+        pump(now);
+        expire(now);
+
+        bool trafficOver = started && (options.script.isEmpty() ? generated >= options.count
+                                                                : scriptIndex >= script.size() && now - startNs >= scriptEndNs);
+        if (trafficOver && chunks.isEmpty()) {
+            bool waiting = false;
+            for (const Message &message : messages) waiting = waiting || message.waiting;
+            if (!waiting) done = true;
+        }
+    }
+
+    // Queues the messages that are due
+    void generate(qint64 now) {
+        if (options.script.isEmpty()) {
+            // Keep a little ahead of the wire; a rate above it is capped by the wire
+            while (generated < options.count && now >= nextRandomNs && queuedBytes() < 128) {
+                QByteArray text;
+                for (int i = 0; i < options.length; i++) {
+                    int c = int(random.bounded(27));
+                    text.append(c == 26 ? ' ' : char('A' + c));
+                }
+                bool corrupt = random.bounded(100.0) < options.corruptPercent;
+                bool split = random.bounded(100.0) < options.splitPercent;
+                queueFrame('M', text.trimmed().isEmpty() ? QByteArray("E") : text, corrupt, split);
+                generated++;
+                nextRandomNs = options.rate > 0 ? nextRandomNs + qint64(1e9 / options.rate) : now;
+            }
+            return;
+        }
+
+        while (scriptIndex < script.size() && now - startNs >= script[scriptIndex].atNs) {
+            const ScriptLine &line = script[scriptIndex++];
+            char type = line.body[0];
+            QByteArray payload = line.body.mid(2);
+            for (int i = 0; i < line.count; i++) {
+                queueFrame(type, payload, line.command == "corrupt", line.command == "split");
+            }
+        }
+    }
+
+    int queuedBytes() const {
+        int total = 0;
+        for (const Chunk &chunk : chunks) total += int(chunk.bytes.size()) - chunk.offset;
+        return total;
+    }
+
+    // Messages and commands go through the outbox like on the PIC, everything else as it is
+    void queueFrame(char type, QByteArray payload, bool corrupt, bool split) {
+        int seq = -1;
+        if (type == 'M' || type == 'K') {
+            seq = nextSeq;
+            nextSeq = (nextSeq + 1) % OutboxSeqLimit;
+            Message &message = messages[seq];
+            if (message.waiting) stats.dropped++; // Its number came round again without an ack
+            message = Message();
+            message.waiting = true;
+            message.corrupt = corrupt;
+            payload = QByteArray::number(seq) + "," + type + "," + payload;
+            type = 'Q';
+            stats.messages++;
+        }
+        if (corrupt) stats.corrupt++;
+
+        QByteArray bytes = encode(type, payload, corrupt);
+        if (split && bytes.size() > 1) {
+            stats.split++;
+            Chunk first;
+            first.bytes = bytes.left(bytes.size() / 2);
+            chunks.append(first);
+            Chunk second;
+            second.bytes = bytes.mid(bytes.size() / 2);
+            second.seq = seq;
+            second.gapMs = options.splitGapMs;
+            chunks.append(second);
+        } else {
+            Chunk chunk;
+            chunk.bytes = bytes;
+            chunk.seq = seq;
+            chunks.append(chunk);
+        }
+    }
+
+    // "$T,payload*CS\r\n"; a corrupt frame gets a checksum that is off by one bit
+    static QByteArray textFrame(char type, QByteArrayView payload, bool corrupt) {
+        QByteArray body = QByteArray(1, type) + "," + payload.toByteArray();
+        quint8 checksum = 0;
+        for (char c : body) checksum ^= quint8(c);
+        if (corrupt) checksum ^= 0x01;
+        return "$" + body + "*" + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+    }
+
+    // Binary once the desktop asked for it, unless the payload is too long;
+    // damaged frames are always text, the desktop reads both framings
+    QByteArray encode(char type, QByteArrayView payload, bool corrupt) const {
+        if (binary && !corrupt) {
+            QByteArray frame = BinaryFraming::encode(type, payload);
+            if (!frame.isEmpty()) return frame;
+        }
+        return textFrame(type, payload, corrupt);
+    }
+
+    // Replies are text, like send_nmea_reply on the PIC
+    void reply(char type, const QByteArray &text) {
+        Chunk chunk;
+        chunk.bytes = textFrame(type, text, false);
+        chunks.append(chunk);
+    }
+
+    // Writes what the wire rate (baud / 10 bytes per second) allows since the last call
+    void pump(qint64 now) {
+        budget = qMin(budget + double(now - lastPumpNs) * options.baud / 10.0 / 1e9, 64.0);
+        lastPumpNs = now;
+
+        while (!chunks.isEmpty()) {
+            Chunk &chunk = chunks.first();
+            if (now < chunk.notBeforeNs) break;
+            int n = qMin(int(budget), int(chunk.bytes.size()) - chunk.offset);
+            if (n <= 0) break;
+            ssize_t written = ::write(fd, chunk.bytes.constData() + chunk.offset, size_t(n));
+            if (written <= 0) break; // The desktop is not reading, try again next tick
+            chunk.offset += int(written);
+            budget -= double(written);
+            stats.bytes += quint64(written);
+            if (chunk.offset < chunk.bytes.size()) break;
+
+            if (chunk.seq >= 0) {
+                messages[chunk.seq].written = true;
+                messages[chunk.seq].sentNs = now;
+            }
+            chunks.removeFirst();
+            if (!chunks.isEmpty() && chunks.first().gapMs > 0) {
+                chunks.first().notBeforeNs = now + qint64(chunks.first().gapMs) * 1000000;
+            }
+        }
+    }
+
+    // Messages whose ack did not come in time
+    void expire(qint64 now) {
+        for (Message &message : messages) {
+            if (!message.waiting || !message.written) continue;
+            if (now - message.sentNs < qint64(options.timeoutMs) * 1000000) continue;
+            message.waiting = false;
+            if (message.corrupt) stats.corruptIgnored++;
+            else stats.dropped++;
+        }
+    }
+
+    void readLink() {
+        char buffer[512];
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n <= 0) return;
+        parser.feed(QByteArrayView(buffer, n), [this](const LinkFrame &frame) { handleFrame(frame); });
+    }
+
+    void handleFrame(const LinkFrame &frame) {
+        if (frame.status != LinkFrame::Valid) {
+            stats.badFramesIn++;
+            log("damaged frame from the desktop");
+            if (arqActive) reply('N', QByteArray::number(arqNext));
+            return;
+        }
+
+        char type = frame.type;
+        QByteArray payload(frame.payload, frame.length);
+
+        // Reliable delivery: ack every copy, handle each number once
+        if (type == 'D') {
+            int comma = payload.indexOf(',');
+            bool ok = false;
+            int seq = comma > 0 ? payload.left(comma).toInt(&ok) : -1;
+            if (!ok || seq >= ArqSeqLimit || payload.size() < comma + 3 || payload[comma + 2] != ',') {
+                stats.badFramesIn++;
+                if (arqActive) reply('N', QByteArray::number(arqNext));
+                return;
+            }
+            reply('A', QByteArray::number(seq));
+            if (!arqActive) {
+                arqActive = true;
+                arqNext = seq;
+                arqSeen = 0;
+            }
+            int offset = (seq - arqNext) & (ArqSeqLimit - 1);
+            if (offset >= ArqSeqLimit / 2) return;
+            if (offset >= 8) {
+                // The desktop gave up on the oldest numbers, slide past them
+                int shift = offset - 7;
+                arqSeen = shift < 8 ? arqSeen >> shift : 0;
+                arqNext = (arqNext + shift) & (ArqSeqLimit - 1);
+                offset = 7;
+            }
+            if (arqSeen & (1u << offset)) return;
+            arqSeen |= 1u << offset;
+            while (arqSeen & 1u) {
+                arqSeen >>= 1;
+                arqNext = (arqNext + 1) & (ArqSeqLimit - 1);
+            }
+            type = payload[comma + 1];
+            payload = payload.mid(comma + 3);
+        }
+
+        if (type == 'M') {
+            stats.messagesIn++;
+            log("LCD line 4: " + QString::fromUtf8(payload));
+        } else if (type == 'K') {
+            handleCommand(payload);
+        }
+    }
+
+    void handleCommand(const QByteArray &payload) {
+        int comma = payload.indexOf(',');
+        QByteArray command = comma >= 0 ? payload.left(comma) : payload;
+        QByteArray parameter = comma >= 0 ? payload.mid(comma + 1) : QByteArray();
+        bool on = parameter.startsWith('1');
+
+        if (command == "hb") {
+            stats.heartbeats++;
+            if (options.waitForLink) startTraffic();
+            return;
+        }
+        if (command == "ack") {
+            acknowledge(parameter.toInt());
+            return;
+        }
+        if (command == "nak") {
+            stats.naksIn++;
+            log("desktop reports a damaged frame");
+            return;
+        }
+
+        stats.commands++;
+        if (command == "rst" || command == "hard_reset") {
+            // Framing and reliable delivery start over after a reset, the outbox numbers do not
+            log(command == "rst" ? "reset" : "full wipe and reset");
+            binary = false;
+            arqActive = false;
+            led = false;
+            buzzer = false;
+        } else if (command == "led_set") {
+            led = on;
+            log(QString("LED %1").arg(led ? "on" : "off"));
+        } else if (command == "buzzer_set") {
+            buzzer = on;
+            log(QString("buzzer %1").arg(buzzer ? "on" : "off"));
+        } else if (command == "bin_set") {
+            reply('K', "bin_ack");
+            binary = on;
+            log(QString("binary framing %1").arg(binary ? "on" : "off"));
+        } else if (command == "arq_set") {
+            reply('K', "arq_ack");
+            arqActive = on;
+            arqNext = 0;
+            arqSeen = 0;
+            log(QString("reliable delivery %1").arg(arqActive ? "on" : "off"));
+        } else if (command == "stat") {
+            reply('S', "ovf=0,long=0,err=" + QByteArray::number(stats.badFramesIn));
+        } else {
+            stats.unknownCommands++;
+            log("UNKNOWN CMD: " + QString::fromUtf8(payload));
+        }
+    }
+
+    void acknowledge(int seq) {
+        if (seq < 0 || seq >= OutboxSeqLimit || !messages[seq].waiting || !messages[seq].written) {
+            stats.lateAcks++;
+            return;
+        }
+        Message &message = messages[seq];
+        message.waiting = false;
+        if (message.corrupt) {
+            stats.corruptAccepted++;
+            return;
+        }
+        stats.acked++;
+        latenciesNs.append(clock.nsecsElapsed() - message.sentNs);
+    }
+
+    static double percentileMs(const QVector<qint64> &sorted, double fraction) {
+        if (sorted.isEmpty()) return 0;
+        int index = qBound(0, int(std::ceil(fraction * sorted.size())) - 1, int(sorted.size()) - 1);
+        return sorted[index] / 1e6;
+    }
+
+    // Prints the results; non-zero if messages were dropped or damaged ones accepted
+    int report() {
+        for (const Message &message : messages) {
+            if (message.waiting && !message.corrupt) stats.dropped++;
+        }
+        QVector<qint64> sorted = latenciesNs;
+        std::sort(sorted.begin(), sorted.end());
+        double seconds = started ? (clock.nsecsElapsed() - startNs) / 1e9 : 0;
+
+        QTextStream out(stdout);
+        out << QString("Virtual PIC report (%1 s of traffic)\n").arg(seconds, 0, 'f', 1);
+        out << QString("  sent             : %1 messages (%2 corrupt, %3 split), %4 bytes, %5 B/s of %6\n")
+                   .arg(stats.messages).arg(stats.corrupt).arg(stats.split).arg(stats.bytes)
+                   .arg(seconds > 0 ? stats.bytes / seconds : 0.0, 0, 'f', 0).arg(options.baud / 10);
+        out << QString("  acked            : %1, dropped %2 (no ack in %3 ms), late or unknown acks %4\n")
+                   .arg(stats.acked).arg(stats.dropped).arg(options.timeoutMs).arg(stats.lateAcks);
+        out << QString("  corrupt frames   : %1 ignored, %2 accepted\n").arg(stats.corruptIgnored).arg(stats.corruptAccepted);
+        out << QString("  latency          : p50 %1 ms, p90 %2 ms, p99 %3 ms, max %4 ms\n")
+                   .arg(percentileMs(sorted, 0.50), 0, 'f', 2).arg(percentileMs(sorted, 0.90), 0, 'f', 2)
+                   .arg(percentileMs(sorted, 0.99), 0, 'f', 2).arg(percentileMs(sorted, 1.0), 0, 'f', 2);
+        out << QString("  from the desktop : %1 heartbeats, %2 messages, %3 commands (%4 unknown), %5 NAKs, %6 damaged frames\n")
+                   .arg(stats.heartbeats).arg(stats.messagesIn).arg(stats.commands).arg(stats.unknownCommands)
+                   .arg(stats.naksIn).arg(stats.badFramesIn);
+        out << QString("  PIC state        : LED %1, buzzer %2, %3 framing, reliable delivery %4\n")
+                   .arg(led ? "on" : "off").arg(buzzer ? "on" : "off").arg(binary ? "binary" : "text")
+                   .arg(arqActive ? "on" : "off");
+        out.flush();
+        return stats.dropped == 0 && stats.corruptAccepted == 0 ? 0 : 1;
+    }
+
+    Options options;
+    int fd;
+    QElapsedTimer clock;
+    QRandomGenerator random;
+    NmeaParser parser;
+    Stats stats;
+
+    QVector<Chunk> chunks;
+    Message messages[OutboxSeqLimit];
+    QVector<qint64> latenciesNs;
+    int nextSeq = 0;
+    double budget = 0;
+    qint64 lastPumpNs = 0;
+
+    QVector<ScriptLine> script;
+    int scriptIndex = 0;
+    qint64 scriptEndNs = 0;
+    int generated = 0;
+    qint64 nextRandomNs = 0;
+    qint64 startNs = 0;
+    bool started = false;
+    bool done = false;
+
+    // What the desktop has switched on
+    bool binary = false;
+    bool arqActive = false;
+    int arqNext = 0;
+    quint32 arqSeen = 0;
+    bool led = false;
+    bool buzzer = false;
+};
+
+// Opens a pty pair and returns the master; the slave stays open (in raw
+// mode) so the master keeps working while the desktop closes and reopens it
+static int openPty(QString *slaveName, int *slaveFd) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+    const char *name = ptsname(master);
+    if (!name) return -1;
+    *slaveName = QString::fromLocal8Bit(name);
+
+    *slaveFd = ::open(name, O_RDWR | O_NOCTTY);
+    if (*slaveFd < 0) return -1;
+    struct termios attributes;
+    if (tcgetattr(*slaveFd, &attributes) == 0) {
+        cfmakeraw(&attributes);
+        tcsetattr(*slaveFd, TCSANOW, &attributes);
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    return master;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgraf_vpic");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Virtual PIC on a pseudo-terminal for load tests of TelgrafApp/telgrafd");
+    parser.addHelpOption();
+    QCommandLineOption scriptOption("script", "Traffic script instead of random messages.", "file");
+    QCommandLineOption rateOption("rate", "Random messages per second, 0 = wire limit.", "n", "10");
+    QCommandLineOption countOption("count", "Random messages to send.", "n", "1000");
+    QCommandLineOption lengthOption("length", "Characters per random message (1-20).", "n", "12");
+    QCommandLineOption corruptOption("corrupt", "Percent of messages sent with a wrong checksum.", "percent", "0");
+    QCommandLineOption splitOption("split", "Percent of frames written in two parts.", "percent", "0");
+    QCommandLineOption splitGapOption("split-gap", "Pause between the two parts in ms.", "ms", "5");
+    QCommandLineOption baudOption("baud", "Wire rate to emulate.", "baud", "9600");
+    QCommandLineOption timeoutOption("timeout", "A message not acked in this time is dropped.", "ms", "2000");
+    QCommandLineOption seedOption("seed", "Seed for the random traffic.", "n", "1");
+    QCommandLineOption linkOption("link", "Also make the pty reachable under this path (symlink).", "path");
+    QCommandLineOption noWaitOption("no-wait", "Start at once instead of at the first heartbeat.");
+    QCommandLineOption verboseOption({"v", "verbose"}, "Log commands and messages from the desktop.");
+    parser.addOptions({scriptOption, rateOption, countOption, lengthOption, corruptOption, splitOption,
+                       splitGapOption, baudOption, timeoutOption, seedOption, linkOption, noWaitOption, verboseOption});
+    parser.process(app);
+
+    VirtualPic::Options options;
+    options.script = parser.value(scriptOption);
+    options.rate = qMax(0.0, parser.value(rateOption).toDouble());
+    options.count = qMax(0, parser.value(countOption).toInt());
+    options.length = qBound(1, parser.value(lengthOption).toInt(), 20);
+    options.corruptPercent = parser.value(corruptOption).toDouble();
+    options.splitPercent = parser.value(splitOption).toDouble();
+    options.splitGapMs = qMax(0, parser.value(splitGapOption).toInt());
+    options.baud = qMax(300, parser.value(baudOption).toInt());
+    options.timeoutMs = qMax(10, parser.value(timeoutOption).toInt());
+    options.seed = parser.value(seedOption).toUInt();
+    options.waitForLink = !parser.isSet(noWaitOption);
+    options.verbose = parser.isSet(verboseOption);
+
+    QTextStream err(stderr);
+    QString slaveName;
+    int slaveFd = -1;
+    int master = openPty(&slaveName, &slaveFd);
+    if (master < 0) {
+        err << "ERROR: cannot open a pseudo-terminal\n";
+        return 2;
+    }
+
+    VirtualPic pic(options, master);
+    QString error;
+    if (!options.script.isEmpty() && !pic.loadScript(&error)) {
+        err << "ERROR: " << error << "\n";
+        return 2;
+    }
+
+    QString link = parser.value(linkOption);
+    if (!link.isEmpty()) {
+        QFile::remove(link);
+        if (!QFile::link(slaveName, link)) {
+            err << "ERROR: cannot create " << link << "\n";
+            return 2;
+        }
+    }
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    QTextStream(stdout) << "Virtual PIC on " << slaveName
+                        << (link.isEmpty() ? QString() : " (" + link + ")")
+                        << (options.waitForLink ? ", waiting for the desktop's heartbeat" : "") << Qt::endl;
+
+    pic.run(app);
+    int result = app.exec();
+
+    if (!link.isEmpty()) QFile::remove(link);
+    ::close(slaveFd);
+    ::close(master);
+    return result;
+}
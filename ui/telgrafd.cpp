@@ -0,0 +1,95 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <QTextStream>
+
+#include <csignal>
+
+#include "TelegraphCore.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <unistd.h>
+
+// SIGINT/SIGTERM are turned into a byte on this socket so the event loop can
+// quit normally and the core gets to flush telegraph.log
+static int signalFds[2] = { -1, -1 };
+
+static void handleQuitSignal(int) {
+    char c = 1;
+    ssize_t ignored = ::write(signalFds[0], &c, sizeof(c));
+    Q_UNUSED(ignored);
+}
+
+static void installQuitHandler(QCoreApplication &app) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, signalFds) != 0) return;
+
+    QSocketNotifier *notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, [&app, notifier]() {
+        notifier->setEnabled(false);
+        char c;
+        ssize_t ignored = ::read(signalFds[1], &c, sizeof(c));
+        Q_UNUSED(ignored);
+        app.quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = handleQuitSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+#endif
+
+// Headless station: same links, command dispatch and log file as TelgrafApp,
+// without any widgets. The link is taken from the Connection/* keys saved in
+// TelgrafApp.conf and re-opened whenever it drops.
+int main(int argc, char *argv[]) {
+#ifdef Q_OS_UNIX
+    // Fork the command spawner while the process is still small and single-threaded
+    SpawnHelper::launch();
+#endif
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("telgrafd");
+    TelegraphCore::registerMetaTypes();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("PIC telegraph station daemon");
+    parser.addHelpOption();
+    QCommandLineOption configOption({"c", "config"}, "Directory holding TelgrafApp.conf and Command.json.", "dir",
+                                    QCoreApplication::applicationDirPath() + "/.config");
+    QCommandLineOption quietOption({"q", "quiet"}, "Only write telegraph.log, do not echo log lines.");
+    QCommandLineOption captureOption("capture", "Record raw link traffic to this file (see telgraf_replay).", "file");
+    parser.addOption(configOption);
+    parser.addOption(quietOption);
+    parser.addOption(captureOption);
+    parser.process(app);
+
+#ifdef Q_OS_UNIX
+    installQuitHandler(app);
+#endif
+
+    TelegraphCore core(parser.value(configOption));
+
+    QTextStream out(stdout);
+    if (!parser.isSet(quietOption)) {
+        QObject::connect(&core, &TelegraphCore::logLines, &app, [&out](const QVector<TelegraphCore::Line> &lines) {
+            for (const TelegraphCore::Line &line : lines) {
+                out << "[" << line.date << " " << line.time << "] " << line.text << "\n";
+            }
+            out.flush();
+        });
+    }
+
+    core.start();
+    if (parser.isSet(captureOption)) core.startCapture(parser.value(captureOption));
+
+    // The link is supervised from here on, so a missing adapter is simply retried
+    if (!core.openSavedLink()) {
+        core.log("SYSTEM ERROR: No saved link in TelgrafApp.conf (Connection/LastPort or Connection/LastAddress).");
+        return 1;
+    }
+
+    return app.exec();
+}